@@ -0,0 +1,142 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "airtime.h"
+
+// Bucket capacity [µs]: the air time allowed within one window
+#define AIRTIME_CAPACITY           ((uint64_t) AIRTIME_WINDOW * 1000000 * AIRTIME_DUTY_CYCLE / 100)
+
+// Token bucket of one transmitter pin
+typedef struct {
+  // Air time that may be used right now [µs]
+  uint64_t tokens;
+  // Last refill [µs]
+  uint64_t updated;
+  // Total air time used [µs]
+  uint64_t used;
+} AirtimeBucketType;
+
+static AirtimeBucketType airtimeBuckets[WAVE_MAX_PIN + 1];
+
+/***********************************************************************************************************************
+ * Start with full buckets
+ **********************************************************************************************************************/
+void AirtimeInit(uint64_t now)
+{
+  for(uint32_t pin = 0; pin <= WAVE_MAX_PIN; pin++) {
+    airtimeBuckets[pin].tokens = AIRTIME_CAPACITY;
+    airtimeBuckets[pin].updated = now;
+    airtimeBuckets[pin].used = 0;
+  }
+}
+
+/***********************************************************************************************************************
+ * Refill a bucket with the air time earned since the last refill
+ **********************************************************************************************************************/
+static AirtimeBucketType *AirtimeRefill(uint32_t pin, uint64_t now)
+{
+  AirtimeBucketType *bucket = &airtimeBuckets[pin];
+  uint64_t earned;
+
+  if(now <= bucket->updated) {
+    return bucket;
+  }
+
+  // Keep the remainder for the next refill
+  earned = (now - bucket->updated) * AIRTIME_DUTY_CYCLE / 100;
+  bucket->updated += earned * 100 / AIRTIME_DUTY_CYCLE;
+  bucket->tokens += earned;
+  if(bucket->tokens >= AIRTIME_CAPACITY) {
+    bucket->tokens = AIRTIME_CAPACITY;
+    bucket->updated = now;
+  }
+
+  return bucket;
+}
+
+/***********************************************************************************************************************
+ * Time until 'airtime' [µs] may be used on 'pin' without exceeding the duty cycle [µs] (0 -> now)
+ **********************************************************************************************************************/
+uint64_t AirtimeDelay(uint32_t pin, uint64_t airtime, uint64_t now)
+{
+  AirtimeBucketType *bucket = AirtimeRefill(pin, now);
+
+  // A transmission longer than the whole bucket has to wait for a full one
+  if(airtime > AIRTIME_CAPACITY) {
+    airtime = AIRTIME_CAPACITY;
+  }
+
+  if(bucket->tokens >= airtime) {
+    return 0;
+  }
+
+  return (airtime - bucket->tokens) * 100 / AIRTIME_DUTY_CYCLE + 1;
+}
+
+/***********************************************************************************************************************
+ * Account 'airtime' [µs] used on 'pin'
+ **********************************************************************************************************************/
+void AirtimeCharge(uint32_t pin, uint64_t airtime, uint64_t now)
+{
+  AirtimeBucketType *bucket = AirtimeRefill(pin, now);
+
+  bucket->tokens = (bucket->tokens > airtime) ? (bucket->tokens - airtime) : 0;
+  bucket->used += airtime;
+}
+
+/***********************************************************************************************************************
+ * Remaining air time budget of 'pin' [µs]
+ **********************************************************************************************************************/
+uint64_t AirtimeBudget(uint32_t pin, uint64_t now)
+{
+  return AirtimeRefill(pin, now)->tokens;
+}
+
+/***********************************************************************************************************************
+ * Budget [µs] after 'elapsed' [µs] without transmissions
+ **********************************************************************************************************************/
+uint64_t AirtimeRefilled(uint64_t budget, uint64_t elapsed)
+{
+  budget += elapsed * AIRTIME_DUTY_CYCLE / 100;
+
+  return (budget < AIRTIME_CAPACITY) ? budget : AIRTIME_CAPACITY;
+}
+
+/***********************************************************************************************************************
+ * Total air time used on 'pin' [µs]
+ **********************************************************************************************************************/
+uint64_t AirtimeUsed(uint32_t pin)
+{
+  return airtimeBuckets[pin].used;
+}
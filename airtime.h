@@ -0,0 +1,46 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef AIRTIME_H_
+#define AIRTIME_H_
+
+#include <stdint.h>
+
+void AirtimeInit(uint64_t now);
+uint64_t AirtimeDelay(uint32_t pin, uint64_t airtime, uint64_t now);
+void AirtimeCharge(uint32_t pin, uint64_t airtime, uint64_t now);
+uint64_t AirtimeBudget(uint32_t pin, uint64_t now);
+uint64_t AirtimeRefilled(uint64_t budget, uint64_t elapsed);
+uint64_t AirtimeUsed(uint32_t pin);
+
+#endif // AIRTIME_H_
@@ -39,6 +39,7 @@
 #include <string.h>
 #include <ctype.h>
 #include "wave.h"
+#include "borga.h"
 
 // Pulse lengths [uS]
 #define SHORT_PULSE    400
@@ -51,95 +52,138 @@
 // Name of the module
 static const char moduleName[] = "borga";
 
+// Default timing
+static const TimingType defaultTiming = { SHORT_PULSE, LONG_PULSE, PAUSE_LENGTH, NUM_REPEATS };
+
 /***********************************************************************************************************************
  * Add one bit to the waveform (0 -> ____/‾‾, 1 -> __/‾‾‾‾)
  **********************************************************************************************************************/
-static void BorgaAddBit(bool bit)
+static void BorgaAddBit(WaveType *wave, const TimingType *timing, bool bit)
 {
-  WaveAddPulse(0, bit ? SHORT_PULSE : LONG_PULSE);
-  WaveAddPulse(1, bit ? LONG_PULSE : SHORT_PULSE);
+  WaveAddPulse(wave, 0, bit ? timing->shortPulse : timing->longPulse);
+  WaveAddPulse(wave, 1, bit ? timing->longPulse : timing->shortPulse);
 }
 
 /***********************************************************************************************************************
- * Borga Handler
+ * Borga Command line parser
  **********************************************************************************************************************/
-void BorgaHandle(int argc, char *argv[])
+ParseType BorgaParse(int argc, char *argv[], CommandType *command)
 {
   // Provide help if asked for
   if(argc < 2) {
     printf(" %s %s channel[0-15] [F]an/[L]ight/[S]peed/[T]imer\n", argv[0], moduleName);
-    return;
+    return ParseIgnored;
   }
 
   // Check if the arguments are meant for us
   if(strcmp(argv[1], moduleName) != 0) {
-    return;
+    return ParseIgnored;
   }
 
   // There should be 2 arguments (plus program name and module name)
   if(argc != 4) {
     fprintf(stderr, "%s: invalid arguments!\n", moduleName);
-    exit(EXIT_FAILURE);
+    return ParseInvalid;
   }
 
   // Convert channel number
   uint8_t channel = atoi(argv[2]);
   if(channel > 15) {
     fprintf(stderr, "%s: invalid channel!\n", moduleName);
-    exit(EXIT_FAILURE);
+    return ParseInvalid;
   }
 
+  command->module = ModuleBorga;
+  command->code = 0;
+  command->channel = channel;
   // Store command char
-  char command = toupper(argv[3][0]);
+  command->command = toupper(argv[3][0]);
+  command->variant = 0;
+
+#ifdef DEBUG
+  // Raw data bits
+  if(command->command == 'D') {
+    for(int i = 1; (i <= 8) && argv[3][i]; i++) {
+      command->code |= (argv[3][i] == '1') << (8 - i);
+    }
+  }
+#endif
+
+  return ParseOk;
+}
+
+/***********************************************************************************************************************
+ * Borga Encoder
+ **********************************************************************************************************************/
+bool BorgaEncode(const CommandType *cmd, WaveType *wave)
+{
+  const TimingType *timing = TimingGet(cmd, &defaultTiming);
+  uint8_t channel = cmd->channel;
+  char command = cmd->command;
+
+  // Commands may come from binary sources, check them again
+  if(channel > 15) {
+    return false;
+  }
 
   // Initialize waveform
-  WaveInitialize(
+  WaveInitialize(wave,
 #ifdef DEBUG
-    SHORT_PULSE
+    timing->shortPulse
 #else
     0
 #endif
   );
 
   // Add start pulse
-  WaveAddPulse(1, SHORT_PULSE);
+  WaveAddPulse(wave, 1, timing->shortPulse);
 
 #ifdef DEBUG
   if(command == 'D') {
-    for(int i = 1; i <= 8; i++) {
-      BorgaAddBit((argv[3][i] == '1'));
+    for(uint8_t mask = 0x80; mask != 0; mask >>= 1) {
+      BorgaAddBit(wave, timing, cmd->code & mask);
     }
   }
   else {
 #endif
     // Bit 0..1: Unknown
-    BorgaAddBit(0);
-    BorgaAddBit(0);
+    BorgaAddBit(wave, timing, 0);
+    BorgaAddBit(wave, timing, 0);
     // Bit 2: Fan toggle
-    BorgaAddBit(command == 'F');
+    BorgaAddBit(wave, timing, command == 'F');
     // Bit 3: Unknown
-    BorgaAddBit(0);
+    BorgaAddBit(wave, timing, 0);
     // Bit 4: Unknown (Reverse toggle?)
-    BorgaAddBit(command == 'R');
+    BorgaAddBit(wave, timing, command == 'R');
     // Bit 5: Timer
-    BorgaAddBit(command == 'T');
+    BorgaAddBit(wave, timing, command == 'T');
     // Bit 6: Speed
-    BorgaAddBit(command == 'S');
+    BorgaAddBit(wave, timing, command == 'S');
     // Bit 7: Light toggle
-    BorgaAddBit(command == 'L');
+    BorgaAddBit(wave, timing, command == 'L');
 #ifdef DEBUG
   }
 #endif
   // Bit 8..11: Address
   for(uint8_t mask = 8; mask != 0; mask >>= 1) {
-    BorgaAddBit(channel & mask);
+    BorgaAddBit(wave, timing, channel & mask);
   }
 
   // Add pause at the end
-  WaveAddPulse(0, PAUSE_LENGTH);
+  WaveAddPulse(wave, 0, timing->pause);
+
+  // Send it several times
+  wave->repetitions = timing->repeats;
 
-  // Transmit wave
-  WaveTransmit(NUM_REPEATS);
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Borga default timing
+ **********************************************************************************************************************/
+const TimingType *BorgaTiming(void)
+{
+  return &defaultTiming;
 }
 
 #endif // MODULE_BORGA_ENABLE
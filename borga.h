@@ -37,10 +37,17 @@
 #include "config.h"
 #ifdef MODULE_BORGA_ENABLE
 
-void BorgaHandle(int argc, char *argv[]);
+#include "command.h"
+#include "timing.h"
+
+ParseType BorgaParse(int argc, char *argv[], CommandType *command);
+bool BorgaEncode(const CommandType *command, WaveType *wave);
+const TimingType *BorgaTiming(void);
 
 #else // MODULE_BORGA_ENABLE
-#define BorgaHandle(x, y)
-#endif // MODULE_DMV7008_ENABLE
+#define BorgaParse(x, y, z) ParseIgnored
+#define BorgaEncode(x, y) false
+#define BorgaTiming() NULL
+#endif // MODULE_BORGA_ENABLE
 
 #endif // BORGA_H_
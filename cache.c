@@ -0,0 +1,283 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "cache.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+
+// Layout identifier
+#define CACHE_MAGIC         0x43465231
+
+// Key of a device: module, code and channel (0 -> free entry)
+#define CACHE_KEY(m, c, ch) ((1U << 31) | ((uint32_t) (m) << 24) | ((uint32_t) (c) << 8) | (ch))
+
+// Last state sent to a device
+typedef struct {
+  uint32_t key;
+  uint32_t state;
+  // CLOCK_REALTIME [s]
+  int64_t sent;
+} CacheEntryType;
+
+// File layout
+typedef struct {
+  uint32_t magic;
+  uint32_t size;
+  // Number of commands sent, shortened and skipped
+  uint64_t sent;
+  uint64_t shortened;
+  uint64_t skipped;
+  CacheEntryType entries[CACHE_SIZE];
+} CacheType;
+
+// Mapped cache (NULL -> disabled)
+static CacheType *cache = NULL;
+static int cacheFd = -1;
+// Other processes share the file, the ring server decides and completes in different threads
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Entries older than this are refreshed with a shortened transmission [s], a forced command is always sent in full
+static uint32_t cacheTtl = CACHE_TTL;
+static bool cacheForce = false;
+
+/***********************************************************************************************************************
+ * Map the cache file, create it if necessary
+ **********************************************************************************************************************/
+bool CacheOpen(const char *fileName)
+{
+  if((cacheFd = open(fileName, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) < 0) {
+    perror(fileName);
+    return false;
+  }
+
+  flock(cacheFd, LOCK_EX);
+  if(ftruncate(cacheFd, sizeof(CacheType)) ||
+     ((cache = mmap(NULL, sizeof(CacheType), PROT_READ | PROT_WRITE, MAP_SHARED, cacheFd, 0)) == MAP_FAILED)) {
+    perror(fileName);
+    close(cacheFd);
+    cache = NULL;
+    return false;
+  }
+
+  // Unknown layout: start over
+  if((cache->magic != CACHE_MAGIC) || (cache->size != CACHE_SIZE)) {
+    memset(cache, 0, sizeof(CacheType));
+    cache->magic = CACHE_MAGIC;
+    cache->size = CACHE_SIZE;
+  }
+  flock(cacheFd, LOCK_UN);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Set the time to live of the entries [s] and whether the cache is ignored for sending
+ **********************************************************************************************************************/
+void CacheSetPolicy(uint32_t ttl, bool force)
+{
+  cacheTtl = ttl;
+  cacheForce = force;
+}
+
+/***********************************************************************************************************************
+ * Find the entry of a device (NULL -> unknown). With 'create' a free one is returned for an unknown device, or the
+ * oldest one nearby to replace.
+ **********************************************************************************************************************/
+static CacheEntryType *CacheEntry(uint32_t key, bool create)
+{
+  CacheEntryType *oldest = NULL;
+
+  for(uint32_t i = 0; i < CACHE_PROBES; i++) {
+    CacheEntryType *entry = &cache->entries[(key * 2654435761U + i) % CACHE_SIZE];
+    if(entry->key == key) {
+      return entry;
+    }
+    if(entry->key == 0) {
+      return create ? entry : NULL;
+    }
+    if((oldest == NULL) || (entry->sent < oldest->sent)) {
+      oldest = entry;
+    }
+  }
+
+  return create ? oldest : NULL;
+}
+
+/***********************************************************************************************************************
+ * Decide whether a command changes the state of its device(s). The whole group is checked for a command to all
+ * channels.
+ **********************************************************************************************************************/
+static CacheActionType CacheCheck(const CommandType *command, int64_t now)
+{
+  uint8_t first = command->channel, last = command->channel;
+  CacheActionType action = CacheSkip;
+
+  if(command->channel == COMMAND_ALL_CHANNELS) {
+    first = 0;
+    last = COMMAND_ALL_CHANNELS - 1;
+  }
+
+  for(uint8_t channel = first; channel <= last; channel++) {
+    CacheEntryType *entry = CacheEntry(CACHE_KEY(command->module, command->code, channel), false);
+    if((entry == NULL) || (entry->state != command->command)) {
+      return CacheSend;
+    }
+    if(now - entry->sent > cacheTtl) {
+      action = CacheShorten;
+    }
+  }
+
+  return action;
+}
+
+/***********************************************************************************************************************
+ * Lock the cache against the other processes and threads
+ **********************************************************************************************************************/
+static void CacheLock(void)
+{
+  pthread_mutex_lock(&cacheLock);
+  flock(cacheFd, LOCK_EX);
+}
+
+/***********************************************************************************************************************
+ * Unlock the cache
+ **********************************************************************************************************************/
+static void CacheUnlock(void)
+{
+  flock(cacheFd, LOCK_UN);
+  pthread_mutex_unlock(&cacheLock);
+}
+
+/***********************************************************************************************************************
+ * Remember the state sent to the device(s)
+ **********************************************************************************************************************/
+static void CacheRemember(const CommandType *command, int64_t now)
+{
+  uint8_t first = command->channel, last = command->channel;
+
+  if(command->channel == COMMAND_ALL_CHANNELS) {
+    first = 0;
+    last = COMMAND_ALL_CHANNELS - 1;
+  }
+
+  for(uint8_t channel = first; channel <= last; channel++) {
+    CacheEntryType *entry = CacheEntry(CACHE_KEY(command->module, command->code, channel), true);
+    entry->key = CACHE_KEY(command->module, command->code, channel);
+    entry->state = command->command;
+    entry->sent = now;
+  }
+}
+
+/***********************************************************************************************************************
+ * Skip or shorten the transmission of an encoded command that does not change the state of its device. Toggling
+ * commands are always sent. The state is only remembered by CacheUpdate() once the telegram has been sent out.
+ **********************************************************************************************************************/
+CacheActionType CacheFilter(const CommandType *command, WaveType *wave)
+{
+  CacheActionType action = CacheSend;
+
+  if((cache == NULL) || !CommandAbsolute(command)) {
+    return CacheSend;
+  }
+
+  CacheLock();
+
+  if(!cacheForce) {
+    action = CacheCheck(command, time(NULL));
+  }
+
+  if(action == CacheSkip) {
+    cache->skipped++;
+  }
+  else if((action == CacheShorten) && (wave->repetitions > CACHE_REPEATS)) {
+    wave->repetitions = CACHE_REPEATS;
+  }
+
+  CacheUnlock();
+
+  return action;
+}
+
+/***********************************************************************************************************************
+ * Remember the state of a command sent out after CacheFilter() returned 'action' for it
+ **********************************************************************************************************************/
+void CacheUpdate(const CommandType *command, CacheActionType action)
+{
+  if((cache == NULL) || !CommandAbsolute(command) || (action == CacheSkip)) {
+    return;
+  }
+
+  CacheLock();
+
+  if(action == CacheShorten) {
+    cache->shortened++;
+  }
+  else {
+    cache->sent++;
+  }
+  CacheRemember(command, time(NULL));
+
+  CacheUnlock();
+}
+
+/***********************************************************************************************************************
+ * Print the statistics of the cache
+ **********************************************************************************************************************/
+void CacheReport(void)
+{
+  if(cache != NULL) {
+    printf("Cache: %llu sent, %llu shortened, %llu skipped\n", (unsigned long long) cache->sent,
+      (unsigned long long) cache->shortened, (unsigned long long) cache->skipped);
+  }
+}
+
+/***********************************************************************************************************************
+ * Unmap the cache
+ **********************************************************************************************************************/
+void CacheClose(void)
+{
+  if(cache != NULL) {
+    munmap(cache, sizeof(CacheType));
+    close(cacheFd);
+    cache = NULL;
+  }
+}
@@ -0,0 +1,481 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "catalog.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gt9000.h"
+#include "rt.h"
+#include "timing.h"
+
+// File identifier and layout version
+#define CATALOG_MAGIC       0x43544652
+#define CATALOG_VERSION              1
+
+// Pulses are stored as an index into the table of distinct pulses
+#define CATALOG_PULSES             256
+// A pulse in the table: level (bit 31) and duration [µs]
+#define CATALOG_LEVEL       0x80000000
+
+// Key of a telegram: module, code, channel, command and variant
+#define CATALOG_KEY(c) (((uint64_t) (c)->module << 40) | ((uint64_t) (c)->code << 24) | \
+                        ((uint64_t) (c)->channel << 16) | ((uint64_t) (c)->command << 8) | (c)->variant)
+// Key without the variant
+#define CATALOG_PREFIX(k)   ((k) >> 8)
+
+// File header, followed by the pulse table, the entries sorted by key and the pulse indices
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t numEntries;
+  uint32_t numPulses;
+  uint32_t pulses[CATALOG_PULSES];
+} CatalogHeaderType;
+
+// One telegram
+typedef struct {
+  uint64_t key;
+  // First pulse index in the file
+  uint32_t offset;
+  uint16_t numPulses;
+  uint16_t repetitions;
+  uint32_t debugPulseLength;
+  uint32_t reserved;
+} CatalogEntryType;
+
+// Address space of a module
+typedef struct {
+  const char *name;
+  ModuleType module;
+  uint32_t numCodes;
+  uint8_t numChannels;
+  uint8_t numCommands;
+  uint8_t commands[8];
+  // Variants are numbered from 1, 0 if there are none
+  uint8_t numVariants;
+} CatalogModuleType;
+
+// Telegrams encoded by one generator thread
+typedef struct {
+  pthread_t thread;
+  CatalogEntryType *entries;
+  uint32_t numEntries;
+  // Pulses (level and duration) of all telegrams
+  uint32_t *pulses;
+  uint32_t numPulses;
+  bool failed;
+} CatalogWorkType;
+
+static const CatalogModuleType catalogModules[] = {
+  { "gt9000",  ModuleGt9000,  1,      5,  2, { 0, 1 },                    GT9000_VARIANTS },
+  { "dmv7008", ModuleDmv7008, 0x1000, 5,  2, { 0, 1 },                    0 },
+  { "borga",   ModuleBorga,   1,      16, 5, { 'F', 'L', 'R', 'S', 'T' }, 0 },
+};
+
+// Mapped catalog file (NULL -> none)
+static const CatalogHeaderType *catalogHeader = NULL;
+static const CatalogEntryType *catalogEntries;
+static const uint8_t *catalogPulses;
+static size_t catalogSize;
+
+/***********************************************************************************************************************
+ * Generator thread: encode the telegrams of the given keys
+ **********************************************************************************************************************/
+static void *CatalogEncode(void *arg)
+{
+  CatalogWorkType *work = arg;
+  static __thread WaveType wave;
+
+  if((work->pulses = malloc(work->numEntries * WAVE_MAX_PULSES * sizeof(work->pulses[0]))) == NULL) {
+    work->failed = true;
+    return NULL;
+  }
+
+  for(uint32_t e = 0; e < work->numEntries; e++) {
+    CatalogEntryType *entry = &work->entries[e];
+    CommandType command = {
+      .module = entry->key >> 40,
+      .code = entry->key >> 24,
+      .channel = entry->key >> 16,
+      .command = entry->key >> 8,
+      .variant = entry->key
+    };
+
+    if(!CommandEncode(&command, &wave)) {
+      work->failed = true;
+      return NULL;
+    }
+
+    entry->offset = work->numPulses;
+    entry->numPulses = wave.numPulses;
+    entry->repetitions = wave.repetitions;
+    entry->debugPulseLength = wave.debugPulseLength;
+    for(uint32_t p = 0; p < wave.numPulses; p++) {
+      work->pulses[work->numPulses++] = (wave.pulses[p].level ? CATALOG_LEVEL : 0) | wave.pulses[p].duration;
+    }
+  }
+
+  return NULL;
+}
+
+/***********************************************************************************************************************
+ * Find the module of a selection ("module" or "module=from-to"), returns the rest behind the name (NULL -> unknown)
+ **********************************************************************************************************************/
+static const char *CatalogModule(const char *selection)
+{
+  for(uint32_t m = 0; m < sizeof(catalogModules) / sizeof(catalogModules[0]); m++) {
+    size_t length = strlen(catalogModules[m].name);
+    if((strncmp(selection, catalogModules[m].name, length) == 0) &&
+       ((selection[length] == '\0') || (selection[length] == '='))) {
+      return &selection[length];
+    }
+  }
+
+  return NULL;
+}
+
+/***********************************************************************************************************************
+ * Collect the keys of the selected modules: "module" or "module=from-to" (code range, hex), all if none is given.
+ * Returns the number of keys, 'keys' may be NULL to count them.
+ **********************************************************************************************************************/
+static int32_t CatalogKeys(int argc, char *argv[], CatalogEntryType *keys)
+{
+  uint32_t numKeys = 0;
+
+  for(int i = 0; i < argc; i++) {
+    if(CatalogModule(argv[i]) == NULL) {
+      fprintf(stderr, "%s: unknown module!\n", argv[i]);
+      return -1;
+    }
+  }
+
+  for(uint32_t m = 0; m < sizeof(catalogModules) / sizeof(catalogModules[0]); m++) {
+    const CatalogModuleType *module = &catalogModules[m];
+    uint32_t from = 0, to = module->numCodes - 1;
+    bool selected = (argc == 0);
+
+    for(int i = 0; i < argc; i++) {
+      const char *range = CatalogModule(argv[i]);
+      if(range != argv[i] + strlen(module->name)) {
+        continue;
+      }
+      selected = true;
+
+      // Code range or a single code
+      if(*range == '=') {
+        int n = sscanf(range + 1, "%x-%x", &from, &to);
+        to = (n == 1) ? from : to;
+        if((n < 1) || (from > to) || (to >= module->numCodes)) {
+          fprintf(stderr, "%s: invalid code range!\n", argv[i]);
+          return -1;
+        }
+      }
+    }
+
+    if(!selected) {
+      continue;
+    }
+
+    // In the order of the keys
+    for(uint32_t code = from; code <= to; code++) {
+      for(uint8_t channel = 0; channel < module->numChannels; channel++) {
+        for(uint8_t c = 0; c < module->numCommands; c++) {
+          for(uint8_t variant = (module->numVariants ? 1 : 0); variant <= module->numVariants; variant++) {
+            if(keys != NULL) {
+              CommandType command = {
+                .module = module->module, .code = code, .channel = channel,
+                .command = module->commands[c], .variant = variant
+              };
+              keys[numKeys].key = CATALOG_KEY(&command);
+            }
+            numKeys++;
+          }
+        }
+      }
+    }
+  }
+
+  return numKeys;
+}
+
+/***********************************************************************************************************************
+ * Replace the pulses of all threads by their index in the pulse table and make the entry offsets global
+ **********************************************************************************************************************/
+static bool CatalogIndex(CatalogHeaderType *header, CatalogWorkType work[], long numThreads)
+{
+  uint32_t offset = 0;
+
+  for(long t = 0; t < numThreads; t++) {
+    for(uint32_t p = 0; p < work[t].numPulses; p++) {
+      uint32_t i;
+      for(i = 0; (i < header->numPulses) && (header->pulses[i] != work[t].pulses[p]); i++);
+      if(i >= CATALOG_PULSES) {
+        return false;
+      }
+      header->pulses[i] = work[t].pulses[p];
+      header->numPulses += (i == header->numPulses);
+      ((uint8_t *) work[t].pulses)[p] = i;
+    }
+    for(uint32_t e = 0; e < work[t].numEntries; e++) {
+      work[t].entries[e].offset += offset;
+    }
+    offset += work[t].numPulses;
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Write a new catalog file and replace the old one, catalogs mapped by running transmitters stay intact
+ **********************************************************************************************************************/
+static bool CatalogWrite(const char *fileName, const CatalogHeaderType *header, const CatalogEntryType entries[],
+  const CatalogWorkType work[], long numThreads)
+{
+  char temporary[strlen(fileName) + 5];
+  FILE *file;
+  bool failed;
+
+  snprintf(temporary, sizeof(temporary), "%s.tmp", fileName);
+  if((file = fopen(temporary, "w")) == NULL) {
+    perror(temporary);
+    return false;
+  }
+
+  fwrite(header, sizeof(*header), 1, file);
+  fwrite(entries, sizeof(*entries), header->numEntries, file);
+  for(long t = 0; t < numThreads; t++) {
+    fwrite(work[t].pulses, 1, work[t].numPulses, file);
+  }
+
+  failed = ferror(file);
+  if(fclose(file) || failed || rename(temporary, fileName)) {
+    perror(fileName);
+    unlink(temporary);
+    return false;
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Encode the telegrams of the selected modules in parallel and write them into a catalog file
+ **********************************************************************************************************************/
+bool CatalogGenerate(const char *fileName, int argc, char *argv[])
+{
+  static CatalogHeaderType header = { .magic = CATALOG_MAGIC, .version = CATALOG_VERSION };
+  uint64_t start = RtNow(), numPulses = 0;
+  long numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+  int32_t numKeys = CatalogKeys(argc, argv, NULL);
+  CatalogEntryType *entries;
+  bool result = true;
+
+  if(numKeys <= 0) {
+    if(numKeys == 0) {
+      fprintf(stderr, "%s: nothing to generate!\n", fileName);
+    }
+    return false;
+  }
+  numThreads = (numThreads < 1) ? 1 : ((numThreads > numKeys) ? numKeys : numThreads);
+
+  CatalogWorkType work[numThreads];
+  memset(work, 0, sizeof(work));
+
+  if((entries = calloc(numKeys, sizeof(*entries))) == NULL) {
+    perror(fileName);
+    return false;
+  }
+  CatalogKeys(argc, argv, entries);
+  header.numEntries = numKeys;
+
+  // The catalog holds the default timings, devices with a profile entry skip it (see CommandEncode())
+  TimingUnload();
+  // Encoded from scratch, not looked up in a catalog mapped with -c (which may be the file being written)
+  CatalogClose();
+
+  // One contiguous share of the keys per core
+  for(long t = 0; t < numThreads; t++) {
+    work[t].entries = &entries[numKeys * t / numThreads];
+    work[t].numEntries = numKeys * (t + 1) / numThreads - numKeys * t / numThreads;
+    if(pthread_create(&work[t].thread, NULL, CatalogEncode, &work[t])) {
+      perror("pthread_create()");
+      numThreads = t;
+      result = false;
+    }
+  }
+  for(long t = 0; t < numThreads; t++) {
+    pthread_join(work[t].thread, NULL);
+    result = result && !work[t].failed;
+    numPulses += work[t].numPulses;
+  }
+
+  if(!result) {
+    fprintf(stderr, "%s: encoding failed!\n", fileName);
+  }
+  else if(!(result = CatalogIndex(&header, work, numThreads))) {
+    fprintf(stderr, "%s: too many different pulses!\n", fileName);
+  }
+  else if((result = CatalogWrite(fileName, &header, entries, work, numThreads))) {
+    fprintf(stderr, "%s: %d telegrams, %llu pulses (%u different), %ld threads, %.3f s\n", fileName, numKeys,
+      (unsigned long long) numPulses, header.numPulses, numThreads, (RtNow() - start) / 1e6);
+  }
+
+  for(long t = 0; t < numThreads; t++) {
+    free(work[t].pulses);
+  }
+  free(entries);
+
+  return result;
+}
+
+/***********************************************************************************************************************
+ * Map a catalog file, telegrams found in it are no longer encoded
+ **********************************************************************************************************************/
+bool CatalogOpen(const char *fileName)
+{
+  const CatalogHeaderType *header;
+  struct stat status;
+  int fd;
+
+  if((fd = open(fileName, O_RDONLY)) < 0) {
+    perror(fileName);
+    return false;
+  }
+
+  if(fstat(fd, &status) || (status.st_size < sizeof(*header))) {
+    fprintf(stderr, "%s: invalid catalog!\n", fileName);
+    close(fd);
+    return false;
+  }
+
+  header = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(header == MAP_FAILED) {
+    perror(fileName);
+    return false;
+  }
+
+  // Layout and size must match
+  if((header->magic != CATALOG_MAGIC) || (header->version != CATALOG_VERSION) ||
+     (header->numPulses > CATALOG_PULSES) ||
+     (status.st_size < sizeof(*header) + (uint64_t) header->numEntries * sizeof(CatalogEntryType))) {
+    fprintf(stderr, "%s: invalid catalog or version!\n", fileName);
+    munmap((void *) header, status.st_size);
+    return false;
+  }
+
+  CatalogClose();
+  catalogHeader = header;
+  catalogEntries = (const CatalogEntryType *) &header[1];
+  catalogPulses = (const uint8_t *) &catalogEntries[header->numEntries];
+  catalogSize = status.st_size;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Look up the telegram of a command and pass its pulses to the wave, returns false if it is not in the catalog.
+ * Without a variant, one of the variants is picked by time.
+ **********************************************************************************************************************/
+bool CatalogLookup(const CommandType *command, WaveType *wave)
+{
+  uint64_t key = CATALOG_KEY(command);
+  uint32_t low = 0, high, count;
+  const CatalogEntryType *entry;
+
+  if(catalogHeader == NULL) {
+    return false;
+  }
+
+  // First entry not below the key
+  high = catalogHeader->numEntries;
+  while(low < high) {
+    uint32_t middle = (low + high) / 2;
+    if(catalogEntries[middle].key < key) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+
+  // Count the variants
+  for(count = 0; (low + count < catalogHeader->numEntries) &&
+      (CATALOG_PREFIX(catalogEntries[low + count].key) == CATALOG_PREFIX(key)) &&
+      (command->variant == 0 || catalogEntries[low + count].key == key); count++);
+  if(count == 0) {
+    return false;
+  }
+
+  if(count > 1) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    low += (now.tv_nsec / 1000) % count;
+  }
+  entry = &catalogEntries[low];
+
+  // Offsets are not trusted
+  if(sizeof(*catalogHeader) + (uint64_t) catalogHeader->numEntries * sizeof(*entry) + entry->offset +
+     entry->numPulses > catalogSize) {
+    return false;
+  }
+
+  WaveInitialize(wave, entry->debugPulseLength);
+  for(uint32_t p = 0; p < entry->numPulses; p++) {
+    uint32_t pulse = catalogHeader->pulses[catalogPulses[entry->offset + p]];
+    WaveAddPulse(wave, pulse & CATALOG_LEVEL, pulse & ~CATALOG_LEVEL);
+  }
+  wave->repetitions = entry->repetitions;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Unmap the catalog
+ **********************************************************************************************************************/
+void CatalogClose(void)
+{
+  if(catalogHeader != NULL) {
+    munmap((void *) catalogHeader, catalogSize);
+    catalogHeader = NULL;
+  }
+}
@@ -0,0 +1,179 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "command.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gt9000.h"
+#include "dmv7008.h"
+#include "borga.h"
+#include "catalog.h"
+#include "timing.h"
+
+// Module names and the number of their first channel on the command line
+static const struct {
+  const char *name;
+  uint8_t firstChannel;
+} commandModules[ModuleInvalid] = {
+  [ModuleGt9000]  = { "gt9000",  1 },
+  [ModuleDmv7008] = { "dmv7008", 1 },
+  [ModuleBorga]   = { "borga",   0 },
+};
+
+/***********************************************************************************************************************
+ * Parse a command line (program name, module name, arguments...), provide help if there are no arguments
+ **********************************************************************************************************************/
+ParseType CommandParse(int argc, char *argv[], CommandType *command)
+{
+  ParseType result = ParseIgnored;
+
+  // Call Module parsers
+  if(result == ParseIgnored) {
+    result = Gt9000Parse(argc, argv, command);
+  }
+  if(result == ParseIgnored) {
+    result = Dmv7008Parse(argc, argv, command);
+  }
+  if(result == ParseIgnored) {
+    result = BorgaParse(argc, argv, command);
+  }
+
+  // Nobody felt responsible
+  if((result == ParseIgnored) && (argc >= 2)) {
+    fprintf(stderr, "%s: unknown module!\n", argv[1]);
+    result = ParseInvalid;
+  }
+
+  return result;
+}
+
+/***********************************************************************************************************************
+ * Encode a command into a waveform, returns false if the command is invalid
+ **********************************************************************************************************************/
+bool CommandEncode(const CommandType *command, WaveType *wave)
+{
+  bool result;
+
+  // Precompiled telegram, unless the device has its own timing
+  if(!TimingCustom(command) && CatalogLookup(command, wave)) {
+    return !wave->overflow;
+  }
+
+  switch(command->module) {
+    case ModuleGt9000:
+      result = Gt9000Encode(command, wave);
+      break;
+
+    case ModuleDmv7008:
+      result = Dmv7008Encode(command, wave);
+      break;
+
+    case ModuleBorga:
+      result = BorgaEncode(command, wave);
+      break;
+
+    default:
+      return false;
+  }
+
+  // Too many pulses
+  return result && !wave->overflow;
+}
+
+/***********************************************************************************************************************
+ * Check if a command sets an absolute state (sending it twice has no further effect) instead of toggling something
+ **********************************************************************************************************************/
+bool CommandAbsolute(const CommandType *command)
+{
+  return (command->module == ModuleGt9000) || (command->module == ModuleDmv7008);
+}
+
+/***********************************************************************************************************************
+ * Name of the module of a command
+ **********************************************************************************************************************/
+const char *CommandName(const CommandType *command)
+{
+  return (command->module < ModuleInvalid) ? commandModules[command->module].name : "?";
+}
+
+/***********************************************************************************************************************
+ * Parse a device pattern: module name, code (hex) and channel as on the command line, '*' for any
+ **********************************************************************************************************************/
+bool CommandParseDevice(const char *module, const char *code, const char *channel, CommandDeviceType *device)
+{
+  for(device->module = 0; device->module < ModuleInvalid; device->module++) {
+    if(strcmp(module, commandModules[device->module].name) == 0) {
+      break;
+    }
+  }
+
+  if((device->module >= ModuleInvalid) || (code == NULL) || (channel == NULL)) {
+    return false;
+  }
+
+  device->code = strcmp(code, "*") ? strtol(code, NULL, 16) : -1;
+  device->channel = strcmp(channel, "*") ? atoi(channel) - commandModules[device->module].firstChannel : -1;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Format a device pattern the way it is parsed
+ **********************************************************************************************************************/
+void CommandFormatDevice(char *buffer, size_t size, const CommandDeviceType *device)
+{
+  char code[12] = "*", channel[12] = "*";
+
+  if(device->code >= 0) {
+    snprintf(code, sizeof(code), "%X", device->code);
+  }
+  if(device->channel >= 0) {
+    snprintf(channel, sizeof(channel), "%d", device->channel + commandModules[device->module].firstChannel);
+  }
+
+  snprintf(buffer, size, "%s %s %s", commandModules[device->module].name, code, channel);
+}
+
+/***********************************************************************************************************************
+ * Check if a command is meant for a device pattern
+ **********************************************************************************************************************/
+bool CommandMatchDevice(const CommandDeviceType *device, const CommandType *command)
+{
+  return (device->module == command->module) &&
+         ((device->code < 0) || (device->code == command->code)) &&
+         ((device->channel < 0) || (device->channel == command->channel));
+}
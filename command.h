@@ -0,0 +1,90 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "wave.h"
+
+// Transmitter modules
+typedef enum {
+  ModuleGt9000 = 0,
+  ModuleDmv7008,
+  ModuleBorga,
+  ModuleInvalid
+} ModuleType;
+
+// Result of parsing a command line
+typedef enum {
+  ParseIgnored = 0,
+  ParseOk,
+  ParseInvalid
+} ParseType;
+
+// Decoded command, independent of its waveform
+typedef struct {
+  ModuleType module;
+  // House code or raw data bits
+  uint16_t code;
+  // Logical channel
+  uint8_t channel;
+  // Switch state or command character
+  uint8_t command;
+  // Alternative code of the same command (0 -> any)
+  uint8_t variant;
+} CommandType;
+
+// Devices matching module, code and channel
+typedef struct {
+  ModuleType module;
+  // -1 -> any
+  int32_t code;
+  int32_t channel;
+} CommandDeviceType;
+
+// Channel addressing all other channels of a code
+#define COMMAND_ALL_CHANNELS         4
+
+ParseType CommandParse(int argc, char *argv[], CommandType *command);
+bool CommandAbsolute(const CommandType *command);
+const char *CommandName(const CommandType *command);
+bool CommandParseDevice(const char *module, const char *code, const char *channel, CommandDeviceType *device);
+void CommandFormatDevice(char *buffer, size_t size, const CommandDeviceType *device);
+bool CommandMatchDevice(const CommandDeviceType *device, const CommandType *command);
+bool CommandEncode(const CommandType *command, WaveType *wave);
+
+#endif // COMMAND_H_
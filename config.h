@@ -36,6 +36,10 @@
 
 // GPIO PIN
 #define OUTPUT_PIN                  12
+// Highest GPIO usable for waves
+#define WAVE_MAX_PIN                31
+// Maximum number of devices in the reachability map
+#define ROUTE_MAX_ENTRIES          256
 
 // Number of tries to initialize the library
 #define INIT_TRIES                 100
@@ -45,6 +49,92 @@
 // Polling delay for wave tx complete [s]
 #define WAVE_TX_POLL_DELAY         0.1
 
+// Polling delay for the hand over between pipelined waves [s]
+#define WAVE_SYNC_POLL_DELAY     0.002
+
+// Time a transmission may take longer than expected before it is cut off and the library is reset [s]
+#define WAVE_WATCHDOG_MARGIN       0.2
+
+// Maximum number of pulses in one telegram
+#define WAVE_MAX_PULSES            128
+
+// Maximum number of telegrams chained into one transmission
+#define WAVE_MAX_CHAIN               8
+
+// Size of the debug visualisation buffer [bytes]
+#define WAVE_DEBUG_BUFFER_SIZE    8192
+
+// Maximum length of a command line in batch mode
+#define BATCH_LINE_LENGTH          256
+// Maximum number of arguments of a command in batch mode (including program name)
+#define BATCH_MAX_ARGS              16
+
+// Realtime mode: SCHED_FIFO priority and stack size touched before locking [bytes]
+#define RT_PRIORITY                 50
+#define RT_STACK_PREFAULT      (64 * 1024)
+
+// Prefix of a file standing in for the device of the SPI or the GPIO character device backend
+#define STAND_IN_PREFIX        "file:"
+
+// SPI backend: bit clock [Hz] and size of the bitstream buffer [bytes]
+#define SPI_BIT_CLOCK           100000
+#define SPI_BUFFER_SIZE        (64 * 1024)
+// Module parameter limiting the size of one spidev transfer, and its value if it can not be read [bytes]
+#define SPI_BUFSIZ_PARAMETER   "/sys/module/spidev/parameters/bufsiz"
+#define SPI_BUFSIZ_DEFAULT        4096
+
+// GPIO character device backend: SCHED_FIFO priority of the thread driving the edges, maximum number of edges in one
+// transmission, allowed edge error [% of the shortest pulse], time from handing over to the first edge [µs], number
+// of edges timed when calibrating and their distance [µs]
+#define LINE_PRIORITY               80
+#define LINE_MAX_EDGES           16384
+#define LINE_TOLERANCE              10
+#define LINE_LEAD                  500
+#define LINE_CALIBRATION           200
+#define LINE_CALIBRATION_STEP      100
+
+// Air time limit per transmitter: duty cycle [%] within a window [s]
+#define AIRTIME_DUTY_CYCLE          10
+#define AIRTIME_WINDOW            3600
+
+// Device state cache: number of devices, entries searched per device, time to live [s] and repeats when refreshing
+// an expired state
+#define CACHE_SIZE                4096
+#define CACHE_PROBES                16
+#define CACHE_TTL                 3600
+#define CACHE_REPEATS                2
+
+// Timing profiles: number of devices, binary search steps per parameter, safety margin on top of the shortest
+// accepted value [%] and shortest pulses tried [% of the current ones]
+#define TIMING_MAX_ENTRIES          64
+#define TIMING_TUNE_STEPS            6
+#define TIMING_MARGIN               20
+#define TIMING_MIN_PULSES           50
+
+// Commands of a batch looked at together when fusing the channels of a code into group telegrams (max. 32)
+#define FUSE_WINDOW                 16
+
+// Shared memory command ring: name, access mode (owner and the group set with -g) and number of slots (power of two)
+#define RING_NAME              "/rftx"
+#define RING_MODE                0660
+#define RING_SIZE                 256
+
+// Polling delay of a submitter waiting for completion [s]
+#define RING_POLL_DELAY           0.01
+
+// Number of telegrams the ring server keeps in flight
+#define SERVER_TELEGRAMS            16
+
+// Idle time after which the ring server shuts the library down [s] (0 -> never), the longest it grows to when the
+// library keeps being needed right after, and how much earlier it is brought up for predicted activity [s]
+#define IDLE_TIMEOUT                60
+#define IDLE_TIMEOUT_MAX          3600
+#define IDLE_WARMUP                0.5
+
+// Scheduler resolution [µs] and number of pending schedules
+#define SCHED_TICK                1000
+#define SCHED_MAX                 4096
+
 // Transmitter Modules
 #define MODULE_GT9000_ENABLE
 #define MODULE_DMV7008_ENABLE
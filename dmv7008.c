@@ -57,6 +57,9 @@
 // Name of the module
 static const char moduleName[] = "dmv7008";
 
+// Default timing
+static const TimingType defaultTiming = { SHORT_PULSE, LONG_PULSE, TLG_PAUSE, NUM_REPEATS };
+
 // Possible states
 typedef enum {
   StateOff = 0,
@@ -95,70 +98,94 @@ static uint8_t Dmv7008GetChannel(ChannelType channel)
 /***********************************************************************************************************************
  * Add one bit to the waveform (0 -> __/‾‾‾‾, 1 -> ____/‾‾)
  **********************************************************************************************************************/
-static void Dmv7008AddBit(BitType bit)
+static void Dmv7008AddBit(WaveType *wave, const TimingType *timing, BitType bit)
 {
-  WaveAddPulse(0, bit ? LONG_PULSE : SHORT_PULSE);
-  WaveAddPulse(1, bit ? SHORT_PULSE : LONG_PULSE);
+  WaveAddPulse(wave, 0, bit ? timing->longPulse : timing->shortPulse);
+  WaveAddPulse(wave, 1, bit ? timing->shortPulse : timing->longPulse);
 }
 
 /***********************************************************************************************************************
- * GT9000 Handler
+ * DMV7008 Command line parser
  **********************************************************************************************************************/
-void Dmv7008Handle(int argc, char *argv[])
+ParseType Dmv7008Parse(int argc, char *argv[], CommandType *command)
 {
   // Provide help if asked for
   if(argc < 2) {
     printf(" %s %s housecoode[000-FFF] channel[1-5] state[0-1]\n", argv[0], moduleName);
-    return;
+    return ParseIgnored;
   }
 
   // Check if the arguments are meant for us
   if(strcmp(argv[1], moduleName) != 0) {
-    return;
+    return ParseIgnored;
   }
 
   // There should be 4 arguments (plus program name)
   if(argc != 5) {
     fprintf(stderr, "%s: invalid arguments!\n", moduleName);
-    exit(EXIT_FAILURE);
+    return ParseInvalid;
   }
 
   // Convert house code
   uint16_t code = strtol(argv[2], NULL, 16);
   if(code > MAX_CODE) {
     fprintf(stderr, "%s: invalid house code!\n", moduleName);
-    exit(EXIT_FAILURE);
+    return ParseInvalid;
   }
 
   // Convert channel number
   ChannelType channel = atoi(argv[3]) - 1;
   if(channel >= ChInvalid) {
     fprintf(stderr, "%s: invalid channel!\n", moduleName);
-    exit(EXIT_FAILURE);
+    return ParseInvalid;
   }
 
   // Convert switch state
   StateType state = atoi(argv[4]);
   if(state >= StateInvalid) {
     fprintf(stderr, "%s: invalid state!\n", moduleName);
-    exit(EXIT_FAILURE);
+    return ParseInvalid;
+  }
+
+  command->module = ModuleDmv7008;
+  command->code = code;
+  command->channel = channel;
+  command->command = state;
+  command->variant = 0;
+
+  return ParseOk;
+}
+
+/***********************************************************************************************************************
+ * DMV7008 Encoder
+ **********************************************************************************************************************/
+bool Dmv7008Encode(const CommandType *command, WaveType *wave)
+{
+  const TimingType *timing = TimingGet(command, &defaultTiming);
+  uint16_t code = command->code;
+  ChannelType channel = command->channel;
+  StateType state = command->command;
+
+  // Commands may come from binary sources, check them again
+  if((code > MAX_CODE) || (channel >= ChInvalid) || (state >= StateInvalid)) {
+    return false;
   }
 
   // Initialize waveform
-  WaveInitialize(
+  WaveInitialize(wave,
 #ifdef DEBUG
-  SHORT_PULSE
+  timing->shortPulse
  #else
    0
  #endif
   );
 
   // Add Start Pulse
-  WaveAddPulse(1, SHORT_PULSE);
+  WaveAddPulse(wave, 1, timing->shortPulse);
 
   // Add Housecode (12 Bits)
   for(int i = 0; i < 12; i++) {
-    Dmv7008AddBit((code & (0x800 >> i)) ? BitOne : BitZero);
+    Dmv7008AddBit(wave, timing, (code & (0x800 >> i)) ? BitOne : BitZero);
   }
 
   // Add Channel (3 Bits)
@@ -166,31 +193,41 @@ void Dmv7008Handle(int argc, char *argv[])
   uint8_t ch = Dmv7008GetChannel(channel);
   for(int i = 0; i < 3; i++) {
     bit = (ch & (0x4 >> i)) ? BitOne : BitZero;
-    Dmv7008AddBit(bit);
+    Dmv7008AddBit(wave, timing, bit);
     csum[i % 2] ^= bit;
   }
 
   // Add Switch state (1 Bit)
   bit = (state) ? BitOne : BitZero;
-  Dmv7008AddBit(bit);
+  Dmv7008AddBit(wave, timing, bit);
   csum[1] ^= bit;
 
   // Add Dim state (1 Bit) (Todo: Not yet supported.)
-  Dmv7008AddBit(BitZero);
+  Dmv7008AddBit(wave, timing, BitZero);
   // Don't forget the checksum here
 
   // Add unknown bit (1 Bit) (Zero)
-  Dmv7008AddBit(BitZero);
+  Dmv7008AddBit(wave, timing, BitZero);
 
   // Add Checksum
-  Dmv7008AddBit(csum[0]);
-  Dmv7008AddBit(csum[1]);
+  Dmv7008AddBit(wave, timing, csum[0]);
+  Dmv7008AddBit(wave, timing, csum[1]);
 
   // Add pause at the end
-  WaveAddPulse(0, TLG_PAUSE);
+  WaveAddPulse(wave, 0, timing->pause);
+
+  // Send it several times
+  wave->repetitions = timing->repeats;
+
+  return true;
+}
 
-  // Transmit wave
-  WaveTransmit(NUM_REPEATS);
+/***********************************************************************************************************************
+ * DMV7008 default timing
+ **********************************************************************************************************************/
+const TimingType *Dmv7008Timing(void)
+{
+  return &defaultTiming;
 }
 
 #endif // MODULE_DMV7008_ENABLE
@@ -37,10 +37,17 @@
 #include "config.h"
 #ifdef MODULE_DMV7008_ENABLE
 
-void Dmv7008Handle(int argc, char *argv[]);
+#include "command.h"
+#include "timing.h"
+
+ParseType Dmv7008Parse(int argc, char *argv[], CommandType *command);
+bool Dmv7008Encode(const CommandType *command, WaveType *wave);
+const TimingType *Dmv7008Timing(void);
 
 #else // MODULE_DMV7008_ENABLE
-#define Dmv7008Handle(x, y)
+#define Dmv7008Parse(x, y, z) ParseIgnored
+#define Dmv7008Encode(x, y) false
+#define Dmv7008Timing() NULL
 #endif // MODULE_DMV7008_ENABLE
 
 #endif // DMV7008_H_
@@ -0,0 +1,143 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "fuse.h"
+
+#include "route.h"
+#include "timing.h"
+
+/***********************************************************************************************************************
+ * Check if a command switches a single channel of a code that has a group channel
+ **********************************************************************************************************************/
+static bool FuseCandidate(const CommandType *command)
+{
+  return CommandAbsolute(command) && (command->channel < COMMAND_ALL_CHANNELS);
+}
+
+/***********************************************************************************************************************
+ * Find the commands switching every channel of the code of commands[first] exactly once, with nothing else sent to
+ * that code in between. Returns their bit mask, 0 if there is no such set.
+ **********************************************************************************************************************/
+static uint32_t FuseScene(const CommandType commands[], uint32_t count, uint32_t first)
+{
+  uint32_t members = 0, channels = 0;
+
+  for(uint32_t i = first; i < count; i++) {
+    if((commands[i].module != commands[first].module) || (commands[i].code != commands[first].code)) {
+      continue;
+    }
+    // Group commands and repeated channels keep their order
+    if(!FuseCandidate(&commands[i]) || (channels & (1 << commands[i].channel))) {
+      return 0;
+    }
+    channels |= 1 << commands[i].channel;
+    members |= 1 << i;
+  }
+
+  return (channels == (1 << COMMAND_ALL_CHANNELS) - 1) ? members : 0;
+}
+
+/***********************************************************************************************************************
+ * Check if the group telegram reaches every member the way their own telegrams would: through one of their
+ * transmitters and with their timing
+ **********************************************************************************************************************/
+static bool FuseReaches(const CommandType *group, const CommandType commands[], uint32_t members)
+{
+  uint32_t pins = RouteReachable(group);
+
+  for(uint32_t i = 0; members; i++, members >>= 1) {
+    if((members & 1) && ((pins & ~RouteReachable(&commands[i])) ||
+                         (TimingGet(&commands[i], NULL) != TimingGet(group, NULL)))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Optimize a command sequence (at most FUSE_WINDOW): the channels of a code switched one by one are switched with the group
+ * telegram to the state most of them get, followed by corrections for the others (no corrections -> only if they all
+ * get the same state). Returns the number of telegrams in 'fused', in the order to be sent.
+ **********************************************************************************************************************/
+uint32_t FuseCommands(const CommandType commands[], uint32_t count, bool corrections, FuseType fused[])
+{
+  uint32_t done = 0, n = 0;
+
+  for(uint32_t i = 0; i < count; i++) {
+    uint32_t members = 0, on = 0;
+    int32_t votes = 0;
+    CommandType group = commands[i];
+
+    if(done & (1 << i)) {
+      continue;
+    }
+
+    if(FuseCandidate(&commands[i])) {
+      members = FuseScene(commands, count, i);
+    }
+
+    // Majority state, ties go to the first command
+    for(uint32_t j = i; j < count; j++) {
+      if(members & (1 << j)) {
+        on |= (commands[j].command == commands[i].command) << j;
+        votes += (commands[j].command == commands[i].command) ? 1 : -1;
+      }
+    }
+    group.channel = COMMAND_ALL_CHANNELS;
+    if(votes < 0) {
+      group.command = !group.command;
+      on ^= members;
+    }
+
+    if(!members || ((on != members) && !corrections) || !FuseReaches(&group, commands, members)) {
+      fused[n].command = commands[i];
+      fused[n++].sources = 1 << i;
+      done |= 1 << i;
+      continue;
+    }
+
+    fused[n].command = group;
+    fused[n++].sources = on;
+    for(uint32_t j = i; j < count; j++) {
+      if((members & ~on) & (1 << j)) {
+        fused[n].command = commands[j];
+        fused[n++].sources = 1 << j;
+      }
+    }
+    done |= members;
+  }
+
+  return n;
+}
@@ -37,9 +37,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <pigpio.h>
+#include <time.h>
 
 #include "wave.h"
+#include "gt9000.h"
 
 // Pulse lengths
 #define SHORT_PULSE                400
@@ -56,6 +57,9 @@
 // Name of the module
 static const char moduleName[] = "gt9000";
 
+// Default timing
+static const TimingType defaultTiming = { SHORT_PULSE, LONG_PULSE, START_PAUSE, NUM_REPEATS };
+
 // Possible states
 typedef enum {
   StateOff = 0,
@@ -81,26 +85,32 @@ typedef enum {
 } BitType;
 
 /***********************************************************************************************************************
- * Get a Code corresponding to channel and state
+ * Get a Code corresponding to channel and state, 'variant' picks one of the group (0 -> time dependent)
  **********************************************************************************************************************/
-static uint16_t Gt9000GetCode(ChannelType channel, StateType state)
+static uint16_t Gt9000GetCode(ChannelType channel, StateType state, uint8_t variant)
 {
   // Code groups
-  static const uint16_t groupA[] = { 0x8F24, 0xC357, 0x57DB, 0xE5C3 };
-  static const uint16_t groupB[] = { 0xBABA, 0x1842, 0x6D01, 0x42F9 };
+  static const uint16_t groupA[GT9000_VARIANTS] = { 0x8F24, 0xC357, 0x57DB, 0xE5C3 };
+  static const uint16_t groupB[GT9000_VARIANTS] = { 0xBABA, 0x1842, 0x6D01, 0x42F9 };
   // Channel and State to Code group assignment table
   static const uint16_t *codeTable[2][5] = {
     //              Ch1     Ch2      Ch3    Ch4     All
     [StateOff] = { groupB, groupB, groupB, groupA, groupA },
     [StateOn]  = { groupA, groupA, groupA, groupB, groupB }
   };
-  static const uint16_t *group;
+  const uint16_t *group;
+  struct timespec now;
   uint8_t pick;
 
   // Get code group
   group = codeTable[state][channel];
+  if(variant) {
+    return group[variant - 1];
+  }
+
   // Pick a time dependent code from code group
-  pick = gpioTick() % (sizeof(groupA) / sizeof(groupA[0]));
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  pick = (now.tv_nsec / 1000) % GT9000_VARIANTS;
 
   return group[pick];
 }
@@ -119,16 +129,16 @@ static uint8_t Gt9000GetChannel(ChannelType channel)
 /***********************************************************************************************************************
  * Add one bit to the waveform (0 -> ‾‾\____, 1 -> ‾‾‾‾\__)
  **********************************************************************************************************************/
-static void Gt9000AddBit(BitType bit)
+static void Gt9000AddBit(WaveType *wave, const TimingType *timing, BitType bit)
 {
-  WaveAddPulse(1, bit ? LONG_PULSE : SHORT_PULSE);
-  WaveAddPulse(0, bit ? SHORT_PULSE : LONG_PULSE);
+  WaveAddPulse(wave, 1, bit ? timing->longPulse : timing->shortPulse);
+  WaveAddPulse(wave, 0, bit ? timing->shortPulse : timing->longPulse);
 }
 
 /***********************************************************************************************************************
- * GT9000 Handler
+ * GT9000 Command line parser
  **********************************************************************************************************************/
-void Gt9000Handle(int argc, char *argv[])
+ParseType Gt9000Parse(int argc, char *argv[], CommandType *command)
 {
   ChannelType channel;
   StateType state;
@@ -136,70 +146,103 @@ void Gt9000Handle(int argc, char *argv[])
   // Provide help if asked for
   if(argc < 2) {
     printf(" %s %s channel[1-5] state[0-1]\n", argv[0], moduleName);
-    return;
+    return ParseIgnored;
   }
 
   // Check if the arguments are meant for us
   if(strcmp(argv[1], moduleName) != 0) {
-    return;
+    return ParseIgnored;
   }
 
   // There should be 3 arguments (plus program name)
   if(argc != 4) {
     fprintf(stderr, "%s: invalid arguments!\n", moduleName);
-    exit(EXIT_FAILURE);
+    return ParseInvalid;
   }
 
   // Convert channel number
   channel = atoi(argv[2]) - 1;
   if(channel >= ChInvalid) {
     fprintf(stderr, "%s: invalid channel!\n", moduleName);
-    exit(EXIT_FAILURE);
+    return ParseInvalid;
   }
 
   // Convert switch state
   state = atoi(argv[3]);
   if(state >= StateInvalid) {
     fprintf(stderr, "%s: invalid state!\n", moduleName);
-    exit(EXIT_FAILURE);
+    return ParseInvalid;
+  }
+
+  command->module = ModuleGt9000;
+  command->code = 0;
+  command->channel = channel;
+  command->command = state;
+  command->variant = 0;
+
+  return ParseOk;
+}
+
+/***********************************************************************************************************************
+ * GT9000 Encoder
+ **********************************************************************************************************************/
+bool Gt9000Encode(const CommandType *command, WaveType *wave)
+{
+  const TimingType *timing = TimingGet(command, &defaultTiming);
+  ChannelType channel = command->channel;
+  StateType state = command->command;
+
+  // Commands may come from binary sources, check them again
+  if((channel >= ChInvalid) || (state >= StateInvalid) || (command->variant > GT9000_VARIANTS)) {
+    return false;
   }
 
   // Initialize waveform
-  WaveInitialize(
+  WaveInitialize(wave,
 #ifdef DEBUG
-  SHORT_PULSE
+  timing->shortPulse
  #else
    0
  #endif
   );
 
   // Add Start Pulse
-  WaveAddPulse(1, SHORT_PULSE);
-  WaveAddPulse(0, START_PAUSE);
+  WaveAddPulse(wave, 1, timing->shortPulse);
+  WaveAddPulse(wave, 0, timing->pause);
 
   // Add Preamble
   const uint8_t preamble[] = { 1, 1, 0, 0 };
   for(int i = 0; i < sizeof(preamble); i++) {
-    Gt9000AddBit(preamble[i]);
+    Gt9000AddBit(wave, timing, preamble[i]);
   }
 
   // Add Code
-  uint16_t code = Gt9000GetCode(channel, state);
+  uint16_t code = Gt9000GetCode(channel, state, command->variant);
   for(int i = 0; i < (sizeof(code) * 8); i++) {
-    Gt9000AddBit((code & (0x8000 >> i)) ? BitOne : BitZero);
+    Gt9000AddBit(wave, timing, (code & (0x8000 >> i)) ? BitOne : BitZero);
   }
 
   // Add Channel
   uint8_t ch = Gt9000GetChannel(channel);
   for(int i = 0; i < 3; i++) {
-    Gt9000AddBit((ch & (0x4 >> i)) ? BitOne : BitZero);
+    Gt9000AddBit(wave, timing, (ch & (0x4 >> i)) ? BitOne : BitZero);
   }
 
   // Add Trailing Zero Bit
-  Gt9000AddBit(BitZero);
+  Gt9000AddBit(wave, timing, BitZero);
 
-  // Transmit wave
-  WaveTransmit(NUM_REPEATS);
+  // Send it several times
+  wave->repetitions = timing->repeats;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * GT9000 default timing
+ **********************************************************************************************************************/
+const TimingType *Gt9000Timing(void)
+{
+  return &defaultTiming;
 }
 
 #endif // MODULE_GT9000_ENABLE
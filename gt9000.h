@@ -35,12 +35,23 @@
 #define GT9000_H_
 
 #include "config.h"
+
+// Number of codes in a code group
+#define GT9000_VARIANTS              4
+
 #ifdef MODULE_GT9000_ENABLE
 
-void Gt9000Handle(int argc, char *argv[]);
+#include "command.h"
+#include "timing.h"
+
+ParseType Gt9000Parse(int argc, char *argv[], CommandType *command);
+bool Gt9000Encode(const CommandType *command, WaveType *wave);
+const TimingType *Gt9000Timing(void);
 
 #else // MODULE_GT9000_ENABLE
-#define Gt9000Handle(x, y)
+#define Gt9000Parse(x, y, z) ParseIgnored
+#define Gt9000Encode(x, y) false
+#define Gt9000Timing() NULL
 #endif // MODULE_GT9000_ENABLE
 
 #endif // GT9000_H_
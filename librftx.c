@@ -0,0 +1,740 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "telegram.h"
+#include "rt.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+// Submitted telegrams waiting for the transmitter
+static RftxTelegramType *rftxQueueHead = NULL;
+static RftxTelegramType *rftxQueueTail = NULL;
+// Telegrams handed over to the wave layer, oldest first
+static RftxTelegramType *rftxInFlight[2];
+static uint32_t rftxNumInFlight = 0;
+// Number of submitted telegrams not yet on air
+static volatile uint32_t rftxBacklog = 0;
+// Telegrams taken out of the queue by RftxCancel(), to be completed by the transmitter thread
+static RftxTelegramType *rftxCancelled = NULL;
+// Watchdog resets of the wave layer seen so far
+static uint32_t rftxResets = 0;
+
+// Idle management [µs]: timeout before the library is shut down and its configured value (0 -> never), end of the
+// last activity, when the library went down and when predicted activity needs it (0 -> none)
+static uint64_t rftxIdleBase = IDLE_TIMEOUT * 1000000ULL;
+static uint64_t rftxIdleTimeout = IDLE_TIMEOUT * 1000000ULL;
+static uint64_t rftxLastActive = 0;
+static uint64_t rftxSuspended = 0;
+static uint64_t rftxWarmAt = 0;
+static RftxIdleStatsType rftxIdleStats;
+
+static pthread_mutex_t rftxLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rftxWakeUp = PTHREAD_COND_INITIALIZER;
+static pthread_t rftxThread;
+static bool rftxRunning = false;
+
+// Completion event counter (-1 -> not open)
+static int rftxEventFd = -1;
+
+/***********************************************************************************************************************
+ * Mark a telegram and the ones chained to it as being transmitted, starting at 'started' (CLOCK_MONOTONIC [µs])
+ **********************************************************************************************************************/
+static void RftxOnAir(RftxTelegramType *telegram, uint64_t started)
+{
+  const WaveType *waves[WAVE_MAX_CHAIN];
+  uint64_t offsets[WAVE_MAX_CHAIN];
+  uint32_t count = 0;
+
+  for(RftxTelegramType *chained = telegram; chained != NULL; chained = chained->chained) {
+    waves[count++] = &chained->wave;
+  }
+  WaveLayout(waves, count, offsets);
+
+  for(count = 0; telegram != NULL; telegram = telegram->chained, count++) {
+    telegram->state = TelegramOnAir;
+    telegram->started = started + offsets[count];
+  }
+  __atomic_sub_fetch(&rftxBacklog, 1, __ATOMIC_SEQ_CST);
+}
+
+/***********************************************************************************************************************
+ * Signal the completion of a telegram and the ones chained to it: done, cancelled or failed
+ **********************************************************************************************************************/
+static void RftxFinish(RftxTelegramType *telegram, TelegramStateType result)
+{
+  RftxTelegramType *chained;
+  uint64_t one = 1;
+
+  for(; telegram != NULL; telegram = chained) {
+    chained = telegram->chained;
+    telegram->result = result;
+    // The telegram may be reused as soon as it is done
+    if(telegram->callback != NULL) {
+      telegram->callback(telegram, telegram->context);
+    }
+    telegram->state = result;
+    if(write(rftxEventFd, &one, sizeof(one)) != sizeof(one)) {
+      perror("RftxFinish()");
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Signal the completion of the oldest telegram in flight and the ones chained to it
+ **********************************************************************************************************************/
+static void RftxComplete(TelegramStateType result)
+{
+  RftxTelegramType *telegram = rftxInFlight[0];
+
+  for(uint32_t i = 1; i < rftxNumInFlight; i++) {
+    rftxInFlight[i - 1] = rftxInFlight[i];
+  }
+  rftxNumInFlight--;
+
+  // The one behind it is on air now, since the end of this one
+  if(rftxNumInFlight) {
+    RftxOnAir(rftxInFlight[0], rftxInFlight[0]->started);
+  }
+
+  RftxFinish(telegram, result);
+}
+
+/***********************************************************************************************************************
+ * Check if a telegram of a transmission has been cancelled
+ **********************************************************************************************************************/
+static bool RftxCancelRequested(const RftxTelegramType *telegram)
+{
+  for(; telegram != NULL; telegram = telegram->chained) {
+    if(__atomic_load_n(&telegram->cancel, __ATOMIC_SEQ_CST)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/***********************************************************************************************************************
+ * Take back the transmissions in flight after they have been cut off for a cancelled telegram: the cancelled
+ * telegrams are completed, the others are queued again in front of the rest, in their order
+ **********************************************************************************************************************/
+static void RftxRequeue(void)
+{
+  RftxTelegramType *cancelled = NULL, **cancelledTail = &cancelled, *head = NULL, **tail = &head, *last = NULL;
+
+  pthread_mutex_lock(&rftxLock);
+
+  for(uint32_t i = 0; i < rftxNumInFlight; i++) {
+    RftxTelegramType *kept = NULL, **link = &kept, *chained;
+
+    for(RftxTelegramType *telegram = rftxInFlight[i]; telegram != NULL; telegram = chained) {
+      chained = telegram->chained;
+      telegram->chained = NULL;
+      if(telegram->cancel) {
+        *cancelledTail = telegram;
+        cancelledTail = &telegram->next;
+      }
+      else {
+        telegram->state = TelegramQueued;
+        *link = telegram;
+        link = &telegram->chained;
+      }
+    }
+    *cancelledTail = NULL;
+
+    // Only the one on air has left the backlog
+    if(kept != NULL) {
+      if(i == 0) {
+        __atomic_add_fetch(&rftxBacklog, 1, __ATOMIC_SEQ_CST);
+      }
+      *tail = last = kept;
+      tail = &kept->next;
+    }
+    else if(i > 0) {
+      __atomic_sub_fetch(&rftxBacklog, 1, __ATOMIC_SEQ_CST);
+    }
+  }
+  rftxNumInFlight = 0;
+
+  if(head != NULL) {
+    *tail = rftxQueueHead;
+    if(rftxQueueHead == NULL) {
+      rftxQueueTail = last;
+    }
+    rftxQueueHead = head;
+  }
+
+  pthread_mutex_unlock(&rftxLock);
+
+  for(RftxTelegramType *telegram = cancelled, *next; telegram != NULL; telegram = next) {
+    next = telegram->next;
+    RftxFinish(telegram, TelegramCancelled);
+  }
+}
+
+/***********************************************************************************************************************
+ * Bring the library up if it is down (lock not held). The idle timeout grows if a telegram needed it soon after it
+ * was shut down and shrinks back after long quiet times. Returns the time it took [µs] (0 -> it was up).
+ **********************************************************************************************************************/
+static uint64_t RftxWake(bool predicted)
+{
+  uint64_t down = RtNow() - rftxSuspended, startup = WaveResume(), timeout = rftxIdleTimeout;
+
+  if(!startup) {
+    return 0;
+  }
+
+  if(!predicted && (down < timeout)) {
+    timeout = (2 * timeout < IDLE_TIMEOUT_MAX * 1000000ULL) ? 2 * timeout : IDLE_TIMEOUT_MAX * 1000000ULL;
+  }
+  else if(down > 2 * timeout) {
+    timeout = (timeout / 2 > rftxIdleBase) ? timeout / 2 : rftxIdleBase;
+  }
+
+  pthread_mutex_lock(&rftxLock);
+  rftxIdleTimeout = timeout;
+  rftxIdleStats.startup = startup;
+  pthread_mutex_unlock(&rftxLock);
+
+  fprintf(stderr, "idle: library up in %llu µs (%s), idle timeout %llu s\n", (unsigned long long) startup,
+    predicted ? "predicted" : "on demand", (unsigned long long) (rftxIdleTimeout / 1000000));
+
+  return startup;
+}
+
+/***********************************************************************************************************************
+ * Account the time to the first edge of a transmission handed over to an idle transmitter
+ **********************************************************************************************************************/
+static void RftxFirstEdge(const RftxTelegramType *telegram, bool cold)
+{
+  uint64_t latency = telegram->started - telegram->submitted;
+
+  pthread_mutex_lock(&rftxLock);
+  if(cold) {
+    rftxIdleStats.coldCount++;
+    rftxIdleStats.coldTotal += latency;
+    rftxIdleStats.coldMax = (latency > rftxIdleStats.coldMax) ? latency : rftxIdleStats.coldMax;
+  }
+  else {
+    rftxIdleStats.warmCount++;
+    rftxIdleStats.warmTotal += latency;
+    rftxIdleStats.warmMax = (latency > rftxIdleStats.warmMax) ? latency : rftxIdleStats.warmMax;
+  }
+  pthread_mutex_unlock(&rftxLock);
+
+  if(cold) {
+    fprintf(stderr, "idle: cold start, first edge after %llu µs\n", (unsigned long long) latency);
+  }
+}
+
+/***********************************************************************************************************************
+ * Nothing to transmit (lock held): shut the library down after the idle timeout unless predicted activity needs it
+ * within that time, bring it up in time for predicted activity. Returns after a submission or a change of plans.
+ **********************************************************************************************************************/
+static void RftxIdle(void)
+{
+  uint64_t now = RtNow(), wake = UINT64_MAX;
+  uint64_t lead = IDLE_WARMUP * 1000000 + rftxIdleStats.startup;
+  bool soon = (rftxWarmAt > now) && (rftxWarmAt - now < rftxIdleTimeout);
+
+  if(WaveActive() && rftxIdleTimeout) {
+    if(now < rftxLastActive + rftxIdleTimeout) {
+      wake = rftxLastActive + rftxIdleTimeout;
+    }
+    else if(soon) {
+      // Keep it up at least until then
+      rftxLastActive = rftxWarmAt;
+      return;
+    }
+    else {
+      pthread_mutex_unlock(&rftxLock);
+      WaveSuspend();
+      pthread_mutex_lock(&rftxLock);
+      rftxSuspended = RtNow();
+      fprintf(stderr, "idle: library down after %llu s\n", (unsigned long long) ((now - rftxLastActive) / 1000000));
+      return;
+    }
+  }
+  else if(!WaveActive() && rftxWarmAt && (rftxWarmAt > now)) {
+    if(now + lead >= rftxWarmAt) {
+      pthread_mutex_unlock(&rftxLock);
+      RftxWake(true);
+      pthread_mutex_lock(&rftxLock);
+      // Keep it up at least until then
+      rftxLastActive = rftxWarmAt;
+      return;
+    }
+    wake = rftxWarmAt - lead;
+  }
+
+  if(wake == UINT64_MAX) {
+    pthread_cond_wait(&rftxWakeUp, &rftxLock);
+    return;
+  }
+
+  struct timespec timeout;
+  clock_gettime(CLOCK_REALTIME, &timeout);
+  timeout.tv_sec += (wake - now) / 1000000;
+  timeout.tv_nsec += ((wake - now) % 1000000) * 1000;
+  if(timeout.tv_nsec >= 1000000000) {
+    timeout.tv_sec++;
+    timeout.tv_nsec -= 1000000000;
+  }
+  pthread_cond_timedwait(&rftxWakeUp, &rftxLock, &timeout);
+}
+
+/***********************************************************************************************************************
+ * Transmitter thread: hands over the submitted telegrams to the wave layer and tracks their completion
+ **********************************************************************************************************************/
+static void *RftxTransmitter(void *arg)
+{
+  // Realtime if asked for, best effort
+  RtThread();
+
+  pthread_mutex_lock(&rftxLock);
+
+  while(rftxRunning || rftxQueueHead || rftxNumInFlight || rftxCancelled) {
+    RftxTelegramType *telegram = rftxQueueHead;
+
+    if(rftxCancelled != NULL) {
+      // Complete the ones cancelled before they were handed over
+      telegram = rftxCancelled;
+      rftxCancelled = telegram->next;
+      pthread_mutex_unlock(&rftxLock);
+      RftxFinish(telegram, TelegramCancelled);
+      pthread_mutex_lock(&rftxLock);
+      continue;
+    }
+
+    // Only one transmission waits behind the one on air, the thread stays free to cut them off
+    if((telegram != NULL) && (rftxNumInFlight < 2)) {
+      // Take the next telegram
+      rftxQueueHead = telegram->next;
+      if(rftxQueueHead == NULL) {
+        rftxQueueTail = NULL;
+      }
+      pthread_mutex_unlock(&rftxLock);
+
+      // Down after being idle
+      uint64_t startup = RftxWake(false);
+
+      // Returns as soon as it is waiting behind the one on air
+      const WaveType *waves[WAVE_MAX_CHAIN];
+      uint32_t count = 0;
+      for(RftxTelegramType *chained = telegram; chained != NULL; chained = chained->chained) {
+        waves[count++] = &chained->wave;
+      }
+      if(!WaveActive() || !WaveQueueChain(waves, count)) {
+        // The hardware did not take it, the host goes on
+        __atomic_sub_fetch(&rftxBacklog, 1, __ATOMIC_SEQ_CST);
+        RftxFinish(telegram, TelegramFailed);
+      }
+      else {
+        // Synchronous backends return after the transmission, the wave layer knows when it started
+        telegram->started = WaveStarted();
+        if(!rftxNumInFlight) {
+          RftxOnAir(telegram, telegram->started);
+          RftxFirstEdge(telegram, startup != 0);
+        }
+        rftxInFlight[rftxNumInFlight++] = telegram;
+      }
+    }
+    else if(rftxNumInFlight) {
+      // Poll for completion, but wake up immediately on new submissions
+      struct timespec timeout;
+      clock_gettime(CLOCK_REALTIME, &timeout);
+      timeout.tv_nsec += WAVE_SYNC_POLL_DELAY * 1000000000;
+      if(timeout.tv_nsec >= 1000000000) {
+        timeout.tv_sec++;
+        timeout.tv_nsec -= 1000000000;
+      }
+      uint64_t start = RtNow();
+      if(pthread_cond_timedwait(&rftxWakeUp, &rftxLock, &timeout) == ETIMEDOUT) {
+        uint64_t slept = RtNow() - start;
+        if(slept > WAVE_SYNC_POLL_DELAY * 1000000) {
+          RtLate(slept - WAVE_SYNC_POLL_DELAY * 1000000);
+        }
+      }
+      pthread_mutex_unlock(&rftxLock);
+    }
+    else {
+      RftxIdle();
+      continue;
+    }
+
+    // Report finished telegrams, the ones in flight when the watchdog reset the wave layer are cut off
+    uint32_t pending = WavePending();
+    bool reset = (WaveResets() != rftxResets);
+    rftxResets = WaveResets();
+    while(rftxNumInFlight > pending) {
+      RftxComplete(reset ? TelegramFailed : TelegramDone);
+    }
+
+    // Cut off the transmission on air holding a cancelled telegram. The one waiting behind it can not be stopped
+    // alone, it is sent again. A cancelled telegram waiting behind the one on air is cut off once it is on air.
+    if(rftxNumInFlight && RftxCancelRequested(rftxInFlight[0])) {
+      WaveCancel();
+      RftxRequeue();
+    }
+    rftxLastActive = RtNow();
+
+    pthread_mutex_lock(&rftxLock);
+  }
+
+  pthread_mutex_unlock(&rftxLock);
+
+  return NULL;
+}
+
+/***********************************************************************************************************************
+ * Set the time after which an idle transmitter shuts the library down [s] (0 -> never), before RftxOpen()
+ **********************************************************************************************************************/
+void RftxSetIdleTimeout(uint32_t seconds)
+{
+  rftxIdleBase = seconds * 1000000ULL;
+  rftxIdleTimeout = rftxIdleBase;
+}
+
+/***********************************************************************************************************************
+ * Initialize the transmitter, returns the completion event file descriptor
+ **********************************************************************************************************************/
+int RftxOpen(void)
+{
+  if(rftxRunning) {
+    return rftxEventFd;
+  }
+
+  if((rftxEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+    perror("eventfd()");
+    return -1;
+  }
+
+  if(!WaveStart()) {
+    close(rftxEventFd);
+    rftxEventFd = -1;
+    return -1;
+  }
+  rftxLastActive = RtNow();
+
+  rftxRunning = true;
+  if(pthread_create(&rftxThread, NULL, RftxTransmitter, NULL)) {
+    perror("pthread_create()");
+    rftxRunning = false;
+    WaveStop();
+    close(rftxEventFd);
+    rftxEventFd = -1;
+    return -1;
+  }
+
+  return rftxEventFd;
+}
+
+/***********************************************************************************************************************
+ * Send out everything submitted so far and shut down the transmitter
+ **********************************************************************************************************************/
+void RftxClose(void)
+{
+  if(!rftxRunning) {
+    return;
+  }
+
+  pthread_mutex_lock(&rftxLock);
+  rftxRunning = false;
+  pthread_cond_signal(&rftxWakeUp);
+  pthread_mutex_unlock(&rftxLock);
+  pthread_join(rftxThread, NULL);
+
+  if(WaveActive()) {
+    WaveFlush();
+    WaveStop();
+  }
+
+  close(rftxEventFd);
+  rftxEventFd = -1;
+}
+
+/***********************************************************************************************************************
+ * Encode a decoded command into a caller provided telegram without touching the hardware
+ **********************************************************************************************************************/
+bool RftxPrepare(RftxTelegramType *telegram, const CommandType *command)
+{
+  telegram->command = *command;
+  telegram->state = TelegramIdle;
+  telegram->chained = NULL;
+
+  return CommandEncode(&telegram->command, &telegram->wave);
+}
+
+/***********************************************************************************************************************
+ * Parse and encode a command (module name, arguments...) into a new telegram without touching the hardware
+ **********************************************************************************************************************/
+RftxTelegramType *RftxEncode(int argc, char *argv[])
+{
+  char *args[argc + 2];
+  RftxTelegramType *telegram;
+
+  if(argc < 1) {
+    return NULL;
+  }
+
+  // Modules expect the program name in front
+  args[0] = "librftx";
+  for(int i = 0; i < argc; i++) {
+    args[i + 1] = argv[i];
+  }
+  args[argc + 1] = NULL;
+
+  if((telegram = calloc(1, sizeof(*telegram))) == NULL) {
+    perror("RftxEncode()");
+    return NULL;
+  }
+
+  if((CommandParse(argc + 1, args, &telegram->command) != ParseOk) || !RftxPrepare(telegram, &telegram->command)) {
+    free(telegram);
+    return NULL;
+  }
+
+  return telegram;
+}
+
+/***********************************************************************************************************************
+ * Free a telegram that is not submitted
+ **********************************************************************************************************************/
+void RftxFree(RftxTelegramType *telegram)
+{
+  free(telegram);
+}
+
+/***********************************************************************************************************************
+ * Transmit a telegram through a given transmitter instead of the first one, returns false if the GPIO is invalid
+ **********************************************************************************************************************/
+bool RftxSetPin(RftxTelegramType *telegram, uint32_t pin)
+{
+  if(pin > WAVE_MAX_PIN) {
+    return false;
+  }
+
+  telegram->wave.pin = pin;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Transmit a telegram in the same wave as another one: right after it on the same pin, at the same time on other
+ * pins (NULL -> on its own). Only the first one of a chain is submitted.
+ **********************************************************************************************************************/
+void RftxChain(RftxTelegramType *telegram, RftxTelegramType *chained)
+{
+  telegram->chained = chained;
+}
+
+/***********************************************************************************************************************
+ * Submit a telegram (and the ones chained to it, as one transmission) and return immediately
+ **********************************************************************************************************************/
+bool RftxSubmit(RftxTelegramType *telegram, RftxCallbackType callback, void *context)
+{
+  uint64_t now = RtNow();
+  uint32_t count = 0;
+
+  if(!rftxRunning) {
+    return false;
+  }
+
+  // Telegrams must not be submitted twice at the same time
+  for(RftxTelegramType *chained = telegram; chained != NULL; chained = chained->chained, count++) {
+    if((count >= WAVE_MAX_CHAIN) || (chained->state == TelegramQueued) || (chained->state == TelegramOnAir)) {
+      return false;
+    }
+  }
+
+  for(RftxTelegramType *chained = telegram; chained != NULL; chained = chained->chained) {
+    chained->callback = callback;
+    chained->context = context;
+    chained->cancel = false;
+    chained->submitted = now;
+    chained->state = TelegramQueued;
+  }
+  telegram->next = NULL;
+  __atomic_add_fetch(&rftxBacklog, 1, __ATOMIC_SEQ_CST);
+
+  pthread_mutex_lock(&rftxLock);
+  if(rftxQueueTail != NULL) {
+    rftxQueueTail->next = telegram;
+  }
+  else {
+    rftxQueueHead = telegram;
+  }
+  rftxQueueTail = telegram;
+  pthread_cond_signal(&rftxWakeUp);
+  pthread_mutex_unlock(&rftxLock);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Take a telegram out of its submission while it is still queued, returns false if it is not queued
+ **********************************************************************************************************************/
+static bool RftxUnqueue(RftxTelegramType *telegram)
+{
+  RftxTelegramType *previous = NULL;
+
+  for(RftxTelegramType **head = &rftxQueueHead; *head != NULL; previous = *head, head = &(*head)->next) {
+    for(RftxTelegramType **link = head; *link != NULL; link = &(*link)->chained) {
+      if(*link != telegram) {
+        continue;
+      }
+
+      if((link == head) && (telegram->chained == NULL)) {
+        // Nothing left of the submission
+        *head = telegram->next;
+        if(rftxQueueTail == telegram) {
+          rftxQueueTail = previous;
+        }
+        __atomic_sub_fetch(&rftxBacklog, 1, __ATOMIC_SEQ_CST);
+      }
+      else if(link == head) {
+        // The next one heads the submission
+        telegram->chained->next = telegram->next;
+        *head = telegram->chained;
+        if(rftxQueueTail == telegram) {
+          rftxQueueTail = telegram->chained;
+        }
+      }
+      else {
+        *link = telegram->chained;
+      }
+      telegram->chained = NULL;
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/***********************************************************************************************************************
+ * Cancel a submitted telegram. A queued one is taken out of its transmission, one handed over to the wave layer cuts
+ * off its transmission and the other telegrams in flight are sent again. The completion is signalled as usual with
+ * the telegram cancelled. Returns false if the telegram is neither queued nor on air.
+ **********************************************************************************************************************/
+bool RftxCancel(RftxTelegramType *telegram)
+{
+  bool result = true;
+
+  pthread_mutex_lock(&rftxLock);
+  if(RftxUnqueue(telegram)) {
+    telegram->next = rftxCancelled;
+    rftxCancelled = telegram;
+  }
+  else if((telegram->state == TelegramQueued) || (telegram->state == TelegramOnAir)) {
+    __atomic_store_n(&telegram->cancel, true, __ATOMIC_SEQ_CST);
+  }
+  else {
+    result = false;
+  }
+  pthread_cond_signal(&rftxWakeUp);
+  pthread_mutex_unlock(&rftxLock);
+
+  return result;
+}
+
+/***********************************************************************************************************************
+ * Get the state of a telegram
+ **********************************************************************************************************************/
+TelegramStateType RftxState(const RftxTelegramType *telegram)
+{
+  return telegram->state;
+}
+
+/***********************************************************************************************************************
+ * Get how a telegram ended: done, cancelled or failed, valid from the completion callback on
+ **********************************************************************************************************************/
+TelegramStateType RftxResult(const RftxTelegramType *telegram)
+{
+  return telegram->result;
+}
+
+/***********************************************************************************************************************
+ * Get the start of the transmission of a telegram, CLOCK_MONOTONIC [µs]
+ **********************************************************************************************************************/
+uint64_t RftxStarted(const RftxTelegramType *telegram)
+{
+  return telegram->started;
+}
+
+/***********************************************************************************************************************
+ * Get the completion event file descriptor, it is incremented for each finished telegram
+ **********************************************************************************************************************/
+int RftxEventFd(void)
+{
+  return rftxEventFd;
+}
+
+/***********************************************************************************************************************
+ * Get the number of submitted telegrams that are not yet on air
+ **********************************************************************************************************************/
+uint32_t RftxBacklog(void)
+{
+  return __atomic_load_n(&rftxBacklog, __ATOMIC_SEQ_CST);
+}
+
+/***********************************************************************************************************************
+ * Announce predicted activity: the library is brought up in time for 'at' (CLOCK_MONOTONIC [µs], 0 -> none)
+ **********************************************************************************************************************/
+void RftxWarmUp(uint64_t at)
+{
+  pthread_mutex_lock(&rftxLock);
+  if(at != rftxWarmAt) {
+    rftxWarmAt = at;
+    pthread_cond_signal(&rftxWakeUp);
+  }
+  pthread_mutex_unlock(&rftxLock);
+}
+
+/***********************************************************************************************************************
+ * Get the idle management statistics
+ **********************************************************************************************************************/
+void RftxIdleStats(RftxIdleStatsType *stats)
+{
+  pthread_mutex_lock(&rftxLock);
+  *stats = rftxIdleStats;
+  stats->idleTimeout = rftxIdleTimeout;
+  stats->active = WaveActive();
+  pthread_mutex_unlock(&rftxLock);
+}
@@ -0,0 +1,87 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef LIBRFTX_H_
+#define LIBRFTX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Telegram states
+typedef enum {
+  TelegramIdle = 0,
+  TelegramQueued,
+  TelegramOnAir,
+  TelegramDone,
+  TelegramCancelled,
+  // Could not be handed over to the hardware or cut off by the watchdog
+  TelegramFailed
+} TelegramStateType;
+
+// Encoded telegram, opaque to the users of the library
+typedef struct RftxTelegram RftxTelegramType;
+
+// Time to the first edge [µs] of transmissions handed over to an idle transmitter, with the library up (warm) or
+// brought up for them (cold)
+typedef struct {
+  uint32_t warmCount, coldCount;
+  uint64_t warmTotal, coldTotal;
+  uint64_t warmMax, coldMax;
+  // Time the library took to come up the last time [µs]
+  uint64_t startup;
+  // Current idle timeout [µs] (0 -> never shut down)
+  uint64_t idleTimeout;
+  bool active;
+} RftxIdleStatsType;
+
+// Completion callback, called from the transmitter thread before the telegram is marked as done, cancelled or failed
+typedef void (*RftxCallbackType)(RftxTelegramType *telegram, void *context);
+
+void RftxSetIdleTimeout(uint32_t seconds);
+int RftxOpen(void);
+void RftxClose(void);
+RftxTelegramType *RftxEncode(int argc, char *argv[]);
+void RftxFree(RftxTelegramType *telegram);
+bool RftxSetPin(RftxTelegramType *telegram, uint32_t pin);
+void RftxChain(RftxTelegramType *telegram, RftxTelegramType *chained);
+bool RftxSubmit(RftxTelegramType *telegram, RftxCallbackType callback, void *context);
+bool RftxCancel(RftxTelegramType *telegram);
+TelegramStateType RftxState(const RftxTelegramType *telegram);
+TelegramStateType RftxResult(const RftxTelegramType *telegram);
+uint64_t RftxStarted(const RftxTelegramType *telegram);
+int RftxEventFd(void);
+uint32_t RftxBacklog(void);
+void RftxWarmUp(uint64_t at);
+void RftxIdleStats(RftxIdleStatsType *stats);
+
+#endif // LIBRFTX_H_
@@ -0,0 +1,452 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "line.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/gpio.h>
+
+// Lines set at the same time: time from the start of the transmission [µs], new values and lines to set (one bit per
+// requested line)
+typedef struct {
+  uint64_t time;
+  uint64_t values;
+  uint64_t mask;
+} LineEdgeType;
+
+// Requested lines (-1 -> closed) or the mock line file that records the driven edges
+static int lineFd = -1;
+static const char *lineChip;
+static bool lineMock;
+// Requested line of each pin (-1 -> not requested)
+static int8_t lineIndex[WAVE_MAX_PIN + 1];
+// All requested lines
+static uint64_t lineMask;
+
+// Edges of the transmission handed over to the thread, the time each one was driven and its timing error
+static LineEdgeType lineEdges[LINE_MAX_EDGES];
+static uint64_t lineDriven[LINE_MAX_EDGES];
+static uint32_t lineNumEdges;
+static LineErrorType lineError;
+static bool lineFailed;
+// Start of the last transmission, CLOCK_MONOTONIC [µs]
+static uint64_t lineStarted;
+
+// Largest edge error when the line was calibrated and in the last transmission [µs] (< 0 -> not known)
+static double lineCalibrated = -1;
+static double lineMeasured = -1;
+// Last decision of LineSuits() (-1 -> none yet)
+static int lineSuited = -1;
+
+// Realtime thread driving the edges
+static pthread_t lineThread;
+static pthread_mutex_t lineLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t lineStart = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t lineDone = PTHREAD_COND_INITIALIZER;
+static bool lineRunning = false;
+static bool lineBusy = false;
+
+/***********************************************************************************************************************
+ * Current CLOCK_MONOTONIC time [ns]
+ **********************************************************************************************************************/
+static uint64_t LineNow(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/***********************************************************************************************************************
+ * Set lines (nothing to do for the mock line, the driven time is recorded by the caller), returns false on failure
+ **********************************************************************************************************************/
+static bool LineSet(uint64_t values, uint64_t mask)
+{
+  struct gpio_v2_line_values set = { .bits = values, .mask = mask };
+
+  if(!lineMock && ioctl(lineFd, GPIO_V2_LINE_SET_VALUES_IOCTL, &set)) {
+    perror(lineChip);
+    return false;
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Drive the edges at their absolute deadlines, starting LINE_LEAD µs from now. Each edge is timed when it has been
+ * set, the error does not add up. A line that can not be set ends the transmission.
+ **********************************************************************************************************************/
+static void LineDrive(void)
+{
+  uint64_t start = LineNow() + LINE_LEAD * 1000ULL;
+  double squares = 0;
+
+  lineStarted = start / 1000;
+  lineError.max = 0;
+  lineFailed = false;
+  for(uint32_t e = 0; e < lineNumEdges; e++) {
+    uint64_t deadline = start + lineEdges[e].time * 1000;
+    struct timespec wake = { deadline / 1000000000, deadline % 1000000000 };
+
+    // Only a signal interrupts it early
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR);
+    if(!LineSet(lineEdges[e].values, lineEdges[e].mask)) {
+      // All low, as far as possible
+      LineSet(0, lineMask);
+      lineNumEdges = e;
+      lineFailed = true;
+      break;
+    }
+    lineDriven[e] = LineNow() - start;
+
+    double deviation = fabs((double) lineDriven[e] - lineEdges[e].time * 1000.0) / 1000;
+    lineError.max = (deviation > lineError.max) ? deviation : lineError.max;
+    squares += deviation * deviation;
+  }
+
+  lineError.rms = lineNumEdges ? sqrt(squares / lineNumEdges) : 0;
+}
+
+/***********************************************************************************************************************
+ * Realtime thread: drives the edges handed over by LineSend()
+ **********************************************************************************************************************/
+static void *LineThreadMain(void *arg)
+{
+  pthread_mutex_lock(&lineLock);
+
+  for(;;) {
+    while(lineRunning && !lineBusy) {
+      pthread_cond_wait(&lineStart, &lineLock);
+    }
+    if(!lineRunning) {
+      break;
+    }
+    pthread_mutex_unlock(&lineLock);
+
+    LineDrive();
+
+    pthread_mutex_lock(&lineLock);
+    lineBusy = false;
+    pthread_cond_signal(&lineDone);
+  }
+
+  pthread_mutex_unlock(&lineLock);
+
+  return NULL;
+}
+
+/***********************************************************************************************************************
+ * Hand the edges over to the thread and wait until they have been driven
+ **********************************************************************************************************************/
+static void LineRun(void)
+{
+  pthread_mutex_lock(&lineLock);
+  lineBusy = true;
+  pthread_cond_signal(&lineStart);
+  while(lineBusy) {
+    pthread_cond_wait(&lineDone, &lineLock);
+  }
+  pthread_mutex_unlock(&lineLock);
+}
+
+/***********************************************************************************************************************
+ * Time the thread without changing the lines: all of them are set low again (they already are), so that nothing is
+ * transmitted
+ **********************************************************************************************************************/
+static void LineCalibrate(void)
+{
+  for(lineNumEdges = 0; lineNumEdges < LINE_CALIBRATION; lineNumEdges++) {
+    lineEdges[lineNumEdges] = (LineEdgeType) { lineNumEdges * LINE_CALIBRATION_STEP, 0, lineMask };
+  }
+  LineRun();
+
+  lineCalibrated = lineError.max;
+  lineMeasured = -1;
+}
+
+/***********************************************************************************************************************
+ * Request the pins as outputs (low) from the GPIO character device and start the realtime thread. With
+ * STAND_IN_PREFIX in front, that file stands in for the chip as a mock line, it records the time each edge was driven.
+ **********************************************************************************************************************/
+bool LineOpen(const char *chip, uint32_t pins)
+{
+  struct gpio_v2_line_request request = { .config.flags = GPIO_V2_LINE_FLAG_OUTPUT };
+  struct sched_param priority = { .sched_priority = LINE_PRIORITY };
+  pthread_attr_t attributes;
+  struct stat status;
+
+  lineMock = !strncmp(chip, STAND_IN_PREFIX, strlen(STAND_IN_PREFIX));
+  if(lineMock) {
+    chip += strlen(STAND_IN_PREFIX);
+  }
+  lineChip = chip;
+
+  memset(lineIndex, -1, sizeof(lineIndex));
+  lineMask = 0;
+  for(uint32_t pin = 0; pin <= WAVE_MAX_PIN; pin++) {
+    if(pins & (1U << pin)) {
+      lineIndex[pin] = request.num_lines;
+      lineMask |= 1ULL << request.num_lines;
+      request.offsets[request.num_lines++] = pin;
+    }
+  }
+
+  if(lineMock) {
+    // Recorded edges are kept when the line is opened again after a suspend
+    int flags = (lineCalibrated < 0) ? O_TRUNC : O_APPEND;
+    if((lineFd = open(chip, O_WRONLY | O_CREAT | O_CLOEXEC | flags, 0644)) < 0) {
+      perror(chip);
+      return false;
+    }
+  }
+  else {
+    int chipFd = open(chip, O_RDWR | O_CLOEXEC);
+    if(chipFd < 0) {
+      perror(chip);
+      return false;
+    }
+    if(fstat(chipFd, &status) || !S_ISCHR(status.st_mode)) {
+      fprintf(stderr, "%s: not a GPIO character device!\n", chip);
+      close(chipFd);
+      return false;
+    }
+    strncpy(request.consumer, "rftx", sizeof(request.consumer) - 1);
+    if(ioctl(chipFd, GPIO_V2_GET_LINE_IOCTL, &request)) {
+      perror(chip);
+      close(chipFd);
+      return false;
+    }
+    close(chipFd);
+    lineFd = request.fd;
+  }
+
+  // Realtime if allowed, the calibration tells how good it is either way
+  pthread_attr_init(&attributes);
+  pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attributes, SCHED_FIFO);
+  pthread_attr_setschedparam(&attributes, &priority);
+  lineRunning = true;
+  if(pthread_create(&lineThread, &attributes, LineThreadMain, NULL)) {
+    fprintf(stderr, "line: realtime priority not available\n");
+    if(pthread_create(&lineThread, NULL, LineThreadMain, NULL)) {
+      perror("pthread_create()");
+      pthread_attr_destroy(&attributes);
+      lineRunning = false;
+      LineClose();
+      return false;
+    }
+  }
+  pthread_attr_destroy(&attributes);
+
+  if(lineCalibrated < 0) {
+    LineCalibrate();
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Sort edges by time
+ **********************************************************************************************************************/
+static int LineCompare(const void *a, const void *b)
+{
+  const LineEdgeType *edgeA = a, *edgeB = b;
+
+  return (edgeA->time > edgeB->time) - (edgeA->time < edgeB->time);
+}
+
+/***********************************************************************************************************************
+ * Turn waveforms into edges, laid out like pigpio waves: one after the other on the same pin, different pins at the
+ * same time. Edges at the same time are set together, levels that do not change are dropped. Returns false if they
+ * do not fit.
+ **********************************************************************************************************************/
+static bool LineEdges(const WaveType *waves[], uint32_t count)
+{
+  uint64_t offsets[WAVE_MAX_CHAIN], values = 0, mask = 0, end;
+  uint32_t n = 0, e;
+
+  end = WaveLayout(waves, count, offsets);
+  for(uint32_t w = 0; w < count; w++) {
+    uint64_t time = offsets[w], line = 1ULL << lineIndex[waves[w]->pin];
+    mask |= line;
+    for(uint32_t r = 0; r < waves[w]->repetitions; r++) {
+      for(uint32_t p = 0; p < waves[w]->numPulses; p++) {
+        if(n >= LINE_MAX_EDGES - 1) {
+          return false;
+        }
+        lineEdges[n++] = (LineEdgeType) { time, waves[w]->pulses[p].level ? line : 0, line };
+        time += waves[w]->pulses[p].duration;
+      }
+    }
+  }
+  qsort(lineEdges, n, sizeof(lineEdges[0]), LineCompare);
+
+  // Low at the end
+  lineEdges[n++] = (LineEdgeType) { end, 0, mask };
+
+  // Merge and drop what does not change
+  for(lineNumEdges = 0, e = 0; e < n; e++) {
+    uint64_t changed = lineEdges[e].mask & (values ^ lineEdges[e].values);
+    values = (values & ~lineEdges[e].mask) | lineEdges[e].values;
+    if(!changed) {
+      continue;
+    }
+    if(lineNumEdges && (lineEdges[lineNumEdges - 1].time == lineEdges[e].time)) {
+      lineEdges[lineNumEdges - 1].mask |= changed;
+      lineEdges[lineNumEdges - 1].values = values;
+    }
+    else {
+      lineEdges[lineNumEdges++] = (LineEdgeType) { lineEdges[e].time, values, changed };
+    }
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Check if the edge error of the thread is within the tolerance of the waveforms (LINE_TOLERANCE % of their
+ * shortest pulse). The last transmission tells best, the calibration before the first one. A transmission out of the
+ * tolerance sends the next one through DMA and gets the line calibrated again.
+ **********************************************************************************************************************/
+bool LineSuits(const WaveType *waves[], uint32_t count)
+{
+  uint32_t shortest = UINT32_MAX;
+  double error;
+
+  if(lineFd < 0) {
+    return false;
+  }
+
+  for(uint32_t w = 0; w < count; w++) {
+    if(lineIndex[waves[w]->pin] < 0) {
+      return false;
+    }
+    for(uint32_t p = 0; p < waves[w]->numPulses; p++) {
+      shortest = (waves[w]->pulses[p].duration < shortest) ? waves[w]->pulses[p].duration : shortest;
+    }
+  }
+
+  double limit = shortest * LINE_TOLERANCE / 100.0;
+  error = (lineMeasured >= 0) ? lineMeasured : lineCalibrated;
+  bool suits = error <= limit;
+  if(!suits && (lineMeasured >= 0)) {
+    LineCalibrate();
+  }
+
+  if((int) suits != lineSuited) {
+    fprintf(stderr, "line: edge error %.2f µs, tolerance %.2f µs, %s\n", error, limit,
+      suits ? "using the GPIO character device" : "using DMA");
+    lineSuited = suits;
+  }
+
+  return suits;
+}
+
+/***********************************************************************************************************************
+ * Drive waveforms through the realtime thread, returns when they have been sent out or false on failure
+ **********************************************************************************************************************/
+bool LineSend(const WaveType *waves[], uint32_t count)
+{
+  if(!LineEdges(waves, count)) {
+    fprintf(stderr, "LineSend(): transmission too long!\n");
+    return false;
+  }
+
+  LineRun();
+  lineMeasured = lineError.max;
+
+  fprintf(stderr, "line: %u edges, edge error max %.2f µs, rms %.2f µs\n", lineNumEdges, lineError.max,
+    lineError.rms);
+
+  // Mock line: when each edge was driven
+  if(lineMock) {
+    FILE *file = fdopen(dup(lineFd), "w");
+    if(file == NULL) {
+      perror(lineChip);
+      return false;
+    }
+    for(uint32_t e = 0; e < lineNumEdges; e++) {
+      for(uint32_t pin = 0; pin <= WAVE_MAX_PIN; pin++) {
+        if((lineIndex[pin] >= 0) && (lineEdges[e].mask & (1ULL << lineIndex[pin]))) {
+          fprintf(file, "%llu %llu %u %u\n", (unsigned long long) lineEdges[e].time,
+            (unsigned long long) (lineDriven[e] / 1000), pin, (uint32_t) ((lineEdges[e].values >> lineIndex[pin]) & 1));
+        }
+      }
+    }
+    if(fclose(file)) {
+      perror(lineChip);
+      return false;
+    }
+  }
+
+  return !lineFailed;
+}
+
+/***********************************************************************************************************************
+ * Get the start of the last transmission, CLOCK_MONOTONIC [µs]
+ **********************************************************************************************************************/
+uint64_t LineStarted(void)
+{
+  return lineStarted;
+}
+
+/***********************************************************************************************************************
+ * Stop the thread and release the lines
+ **********************************************************************************************************************/
+void LineClose(void)
+{
+  if(lineRunning) {
+    pthread_mutex_lock(&lineLock);
+    lineRunning = false;
+    pthread_cond_signal(&lineStart);
+    pthread_mutex_unlock(&lineLock);
+    pthread_join(lineThread, NULL);
+  }
+
+  if(lineFd >= 0) {
+    close(lineFd);
+    lineFd = -1;
+  }
+}
@@ -34,29 +34,686 @@
 #include "config.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
 
-#include "gt9000.h"
-#include "dmv7008.h"
-#include "borga.h"
+#include "wave.h"
+#include "command.h"
+#include "ring.h"
+#include "rt.h"
+#include "airtime.h"
+#include "route.h"
+#include "catalog.h"
+#include "cache.h"
+#include "timing.h"
+#include "fuse.h"
+#include "server.h"
 
 #ifndef GIT_VERSION
 #define GIT_VERSION "Unknown"
 #endif
 
+// Telegrams of a scene composed into one transmission and the air time queued on each transmitter [µs]
+typedef struct {
+  const WaveType *waves[WAVE_MAX_CHAIN];
+  const FuseType *fused[WAVE_MAX_CHAIN];
+  CacheActionType actions[WAVE_MAX_CHAIN];
+  uint32_t count;
+  uint64_t load[WAVE_MAX_PIN + 1];
+  // A transmission could not be handed over
+  bool failed;
+} RftxChainType;
+
+/***********************************************************************************************************************
+ * Hand over the composed transmission behind the one on air and start composing the next one. 'starts' are the
+ * arrival times of the commands of the scene.
+ **********************************************************************************************************************/
+static void RftxChainSend(RftxChainType *chain, const uint64_t starts[])
+{
+  uint64_t offsets[WAVE_MAX_CHAIN];
+
+  if(chain->count) {
+    WaveLayout(chain->waves, chain->count, offsets);
+    if(!WaveQueueChain(chain->waves, chain->count)) {
+      chain->failed = true;
+    }
+    else {
+      for(uint32_t i = 0; i < chain->count; i++) {
+        CacheUpdate(&chain->fused[i]->command, chain->actions[i]);
+        // Latency of the oldest command carried out
+        RtReport(CommandName(&chain->fused[i]->command), starts[__builtin_ctz(chain->fused[i]->sources)],
+          WaveStarted() + offsets[i]);
+      }
+    }
+  }
+
+  chain->count = 0;
+  memset(chain->load, 0, sizeof(chain->load));
+}
+
+/***********************************************************************************************************************
+ * Send a waveform via the transmitter reaching the device with the least air time queued in the transmission being
+ * composed ('chain', NULL -> none), hold it back until the air time budget allows. The composed transmission is
+ * handed over before waiting.
+ **********************************************************************************************************************/
+static bool RftxRoute(const CommandType *command, WaveType *wave, RftxChainType *chain, const uint64_t starts[])
+{
+  uint32_t pins = RouteReachable(command);
+  uint64_t airtime = WaveAirtime(wave), wait = UINT64_MAX;
+
+  if(pins == 0) {
+    fprintf(stderr, "No transmitter reaches the device!\n");
+    return false;
+  }
+
+  while((wave->pin = RouteSelect(pins, airtime, (chain != NULL) ? chain->load : NULL, RtNow(), &wait)) ==
+        ROUTE_NONE) {
+    if(chain != NULL) {
+      RftxChainSend(chain, starts);
+    }
+    fprintf(stderr, "airtime: budget exhausted, waiting %.3f s\n", wait / 1e6);
+    RtSleep(wait / 1e6);
+    wait = UINT64_MAX;
+  }
+  AirtimeCharge(wave->pin, airtime, RtNow());
+  if(chain != NULL) {
+    chain->load[wave->pin] += airtime;
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Transmit the commands read in one go, the channels of a code switched one by one become a group telegram. The
+ * telegrams are spread over the transmitters reaching the devices and sent as one transmission, different
+ * transmitters send at the same time.
+ **********************************************************************************************************************/
+static bool RftxScene(const CommandType commands[], const uint64_t starts[], uint32_t count)
+{
+  static FuseType fused[FUSE_WINDOW];
+  static WaveType waves[FUSE_WINDOW];
+  static RftxChainType chain;
+  uint32_t n = FuseCommands(commands, count, true, fused);
+  bool result = true;
+
+  if(n < count) {
+    fprintf(stderr, "fuse: %u commands in %u telegrams\n", count, n);
+  }
+
+  chain.failed = false;
+
+  for(uint32_t i = 0; i < n; i++) {
+    CacheActionType action;
+
+    if(!CommandEncode(&fused[i].command, &waves[i])) {
+      result = false;
+      continue;
+    }
+
+    // The device is already in that state
+    if((action = CacheFilter(&fused[i].command, &waves[i])) == CacheSkip) {
+      continue;
+    }
+
+    // Full: the next transmission
+    if(chain.count >= WAVE_MAX_CHAIN) {
+      RftxChainSend(&chain, starts);
+    }
+
+    if(!RftxRoute(&fused[i].command, &waves[i], &chain, starts)) {
+      result = false;
+      continue;
+    }
+
+    chain.waves[chain.count] = &waves[i];
+    chain.fused[chain.count] = &fused[i];
+    chain.actions[chain.count] = action;
+    chain.count++;
+  }
+
+  RftxChainSend(&chain, starts);
+
+  return result && !chain.failed;
+}
+
+/***********************************************************************************************************************
+ * Check if more commands are waiting on stdin
+ **********************************************************************************************************************/
+static bool RftxWaiting(void)
+{
+  struct pollfd input = { .fd = fileno(stdin), .events = POLLIN };
+
+  return poll(&input, 1, 0) > 0;
+}
+
+/***********************************************************************************************************************
+ * Batch mode: read one command per line from stdin and transmit them back to back. The commands available at once
+ * are fused into group telegrams where possible. The next telegram is encoded and created while the current one is
+ * on air.
+ **********************************************************************************************************************/
+static int RftxBatch(char *program)
+{
+  static char line[BATCH_LINE_LENGTH];
+  static CommandType commands[FUSE_WINDOW];
+  static uint64_t starts[FUSE_WINDOW];
+  uint32_t count = 0;
+  int result = EXIT_SUCCESS;
+  bool more = true;
+
+  // Read byte by byte, so that poll() sees the lines not read yet
+  setvbuf(stdin, NULL, _IONBF, 0);
+
+  if(!RtThread() || !WaveStart()) {
+    return EXIT_FAILURE;
+  }
+  AirtimeInit(RtNow());
+
+  while(more) {
+    char *argv[BATCH_MAX_ARGS + 1];
+    int argc = 0;
+
+    if((more = (fgets(line, sizeof(line), stdin) != NULL))) {
+      starts[count] = RtNow();
+
+      // Split line into arguments
+      argv[argc++] = program;
+      for(char *arg = strtok(line, " \t\r\n"); arg != NULL; arg = strtok(NULL, " \t\r\n")) {
+        if(argc >= BATCH_MAX_ARGS) {
+          break;
+        }
+        argv[argc++] = arg;
+      }
+      argv[argc] = NULL;
+
+      // Skip empty lines and comments
+      if((argc >= 2) && (argv[1][0] != '#')) {
+        if(CommandParse(argc, argv, &commands[count]) == ParseOk) {
+          count++;
+        }
+        else {
+          result = EXIT_FAILURE;
+        }
+      }
+    }
+
+    // Send what has been read once there is nothing more to wait for
+    if(count && (!more || (count >= FUSE_WINDOW) || !RftxWaiting())) {
+      if(!RftxScene(commands, starts, count)) {
+        result = EXIT_FAILURE;
+      }
+      count = 0;
+    }
+  }
+
+  WaveFlush();
+  WaveStop();
+
+  // Cut off by the watchdog
+  return WaveResets() ? EXIT_FAILURE : result;
+}
+
+/***********************************************************************************************************************
+ * Parse an optional schedule in front of the module name: "at <epoch seconds>", "at m<monotonic seconds>" or
+ * "in <ms>". It is removed from the arguments and its CLOCK_MONOTONIC time [µs] is stored in 'start' (0 -> now).
+ **********************************************************************************************************************/
+static bool RftxParseSchedule(int *argc, char **argv[], uint64_t *start)
+{
+  char **args = *argv, *end;
+  double value;
+
+  *start = 0;
+  if((*argc < 2) || (strcmp(args[1], "at") && strcmp(args[1], "in"))) {
+    return true;
+  }
+
+  if(*argc < 3) {
+    fprintf(stderr, "%s: missing time!\n", args[1]);
+    return false;
+  }
+
+  if(strcmp(args[1], "in") == 0) {
+    // Relative [ms]
+    value = strtod(args[2], &end);
+    *start = RtNow() + (uint64_t) (value * 1000);
+  }
+  else if(args[2][0] == 'm') {
+    // Monotonic clock [s]
+    uint64_t now = RtNow();
+    value = strtod(&args[2][1], &end) - now / 1e6;
+    *start = now + (int64_t) (value * 1000000);
+  }
+  else {
+    // Wall clock [s]
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    value = strtod(args[2], &end) - (now.tv_sec + now.tv_nsec / 1e9);
+    *start = RtNow() + (int64_t) (value * 1000000);
+  }
+
+  if((*end != '\0') || (value < 0)) {
+    fprintf(stderr, "%s: invalid time!\n", args[1]);
+    return false;
+  }
+
+  // Drop the schedule from the arguments
+  args[2] = args[0];
+  *argv += 2;
+  *argc -= 2;
+
+  return true;
+}
+
+// Set by SIGINT / SIGTERM while waiting for a submitted command
+static volatile sig_atomic_t rftxInterrupted = 0;
+
+/***********************************************************************************************************************
+ * Signal handler of the submitting client
+ **********************************************************************************************************************/
+static void RftxInterrupt(int signal)
+{
+  rftxInterrupted = 1;
+}
+
+/***********************************************************************************************************************
+ * Submit a command to the running transmitter through the shared memory ring and wait for its completion. The
+ * command is cancelled if the client is interrupted.
+ **********************************************************************************************************************/
+static int RftxSubmit(const CommandType *command, uint8_t priority, uint64_t start, uint32_t deadline)
+{
+  static const char *statusNames[] = {
+    [RingUnknown] = "lost", [RingSubmitted] = "submitted", [RingDone] = "done",
+    [RingExpired] = "expired", [RingInvalid] = "invalid", [RingRejected] = "rejected",
+    [RingCancelled] = "cancelled", [RingFailed] = "failed"
+  };
+  RingRecordType record = {
+    .command = *command,
+    .priority = priority,
+    .start = start,
+    .deadline = deadline ? (start ? start : RtNow()) + deadline * 1000ULL : 0
+  };
+  RingStatusType status;
+  RingType *ring;
+  int64_t ticket;
+
+  if((ring = RingOpen(false)) == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  if((ticket = RingSubmit(ring, &record)) < 0) {
+    fprintf(stderr, "%s: ring full!\n", RING_NAME);
+    return EXIT_FAILURE;
+  }
+
+  sigaction(SIGINT, &(struct sigaction) { .sa_handler = RftxInterrupt }, NULL);
+  sigaction(SIGTERM, &(struct sigaction) { .sa_handler = RftxInterrupt }, NULL);
+
+  // Wait for the transmitter
+  while((status = RingStatus(ring, ticket)) == RingSubmitted) {
+    if(rftxInterrupted == 1) {
+      RingCancel(ring, ticket);
+      rftxInterrupted = 2;
+    }
+    nanosleep(&(struct timespec) { 0, RING_POLL_DELAY * 1000000000 }, NULL);
+  }
+  RingClose(ring);
+
+  if(status != RingDone) {
+    fprintf(stderr, "%s: command %s!\n", RING_NAME, statusNames[status]);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/***********************************************************************************************************************
+ * Cancel a command submitted to the running transmitter
+ **********************************************************************************************************************/
+static int RftxCancel(uint64_t ticket)
+{
+  RingType *ring;
+  bool result;
+
+  if((ring = RingOpen(false)) == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  if(!(result = RingCancel(ring, ticket))) {
+    fprintf(stderr, "%s: ticket %llu not pending!\n", RING_NAME, (unsigned long long) ticket);
+  }
+  RingClose(ring);
+
+  return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/***********************************************************************************************************************
+ * Print the statistics of the running transmitter
+ **********************************************************************************************************************/
+static int RftxInfo(void)
+{
+  RingType *ring;
+  uint64_t updated, elapsed;
+  uint32_t pins;
+  RingStatsType *stats;
+
+  CacheReport();
+
+  if((ring = RingOpen(false)) == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  // The budget refills while the transmitter is idle
+  updated = __atomic_load_n(&ring->stats.updated, __ATOMIC_ACQUIRE);
+  elapsed = RtNow() - updated;
+  pins = __atomic_load_n(&ring->stats.pins, __ATOMIC_RELAXED);
+  for(uint32_t pin = 0; pin <= WAVE_MAX_PIN; pin++) {
+    uint64_t airtime = __atomic_load_n(&ring->stats.airtime[pin], __ATOMIC_RELAXED);
+    if(airtime || (pins & (1U << pin))) {
+      printf("GPIO %2u: air time %.3f s, budget %.3f s\n", pin, airtime / 1e6,
+        AirtimeRefilled(__atomic_load_n(&ring->stats.budget[pin], __ATOMIC_RELAXED), elapsed) / 1e6);
+    }
+  }
+
+  // Idle management
+  stats = &ring->stats;
+  printf("Library: %s, idle timeout %u s, start-up %llu µs\n", __atomic_load_n(&stats->active, __ATOMIC_RELAXED) ?
+    "up" : "down", __atomic_load_n(&stats->idleTimeout, __ATOMIC_RELAXED),
+    (unsigned long long) __atomic_load_n(&stats->startup, __ATOMIC_RELAXED));
+  printf("First edge: warm %u x avg %llu µs max %llu µs, cold %u x avg %llu µs max %llu µs\n",
+    __atomic_load_n(&stats->warmCount, __ATOMIC_RELAXED),
+    (unsigned long long) __atomic_load_n(&stats->warmAverage, __ATOMIC_RELAXED),
+    (unsigned long long) __atomic_load_n(&stats->warmMax, __ATOMIC_RELAXED),
+    __atomic_load_n(&stats->coldCount, __ATOMIC_RELAXED),
+    (unsigned long long) __atomic_load_n(&stats->coldAverage, __ATOMIC_RELAXED),
+    (unsigned long long) __atomic_load_n(&stats->coldMax, __ATOMIC_RELAXED));
+  RingClose(ring);
+
+  return EXIT_SUCCESS;
+}
+
 /***********************************************************************************************************************
  * Main
  **********************************************************************************************************************/
 int main(int argc, char *argv[])
 {
+  static CommandType command;
+  static WaveType wave;
+  bool batch = false, serve = false, submit = false, info = false, force = false, tune = false;
+  uint32_t ttl = CACHE_TTL, idle = IDLE_TIMEOUT;
+  char *generate = NULL, *profile = NULL, *cancel = NULL;
+  uint8_t priority = 0;
+  uint32_t deadline = 0;
+  uint64_t start, scheduled;
+  int opt;
+
+  // Parse options preceding the module name
+  while((opt = getopt(argc, argv, "+bc:d:fg:im:p:rst:uv:x:C:G:I:L:P:R:S:T:")) != -1) {
+    switch(opt) {
+      // Read commands from stdin
+      case 'b':
+        batch = true;
+        break;
+
+      // Precompiled telegrams
+      case 'c':
+        if(!CatalogOpen(optarg)) {
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      // Deadline of the submitted command [ms]
+      case 'd':
+        deadline = atoi(optarg);
+        break;
+
+      // Send even if the device is known to be in that state
+      case 'f':
+        force = true;
+        break;
+
+      // Statistics of the running transmitter
+      case 'i':
+        info = true;
+        break;
+
+      // Reachability map of the devices
+      case 'm':
+        if(!RouteLoad(optarg)) {
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      // Priority of the submitted command
+      case 'p':
+        priority = atoi(optarg);
+        break;
+
+      // Serve the shared memory command ring
+      case 'r':
+        serve = true;
+        break;
+
+      // Submit the command to the running transmitter
+      case 's':
+        submit = true;
+        break;
+
+      // Time to live of the device states [s]
+      case 't':
+        ttl = atoi(optarg);
+        break;
+
+      // Tune the timing of the device
+      case 'u':
+        tune = true;
+        break;
+
+      // Export the transmitted waveform into a VCD file
+      case 'v':
+        WaveSetVcdFile(optarg);
+        break;
+
+      // Cancel a submitted command
+      case 'x':
+        cancel = optarg;
+        break;
+
+      // Device state cache
+      case 'C':
+        if(!CacheOpen(optarg)) {
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      // Generate a catalog of precompiled telegrams
+      case 'G':
+        generate = optarg;
+        break;
+
+      // Idle timeout of the transmitter [s]
+      case 'I':
+        idle = atoi(optarg);
+        break;
+
+      // Timing profile of the devices
+      case 'P':
+        profile = optarg;
+        break;
+
+      // Realtime mode on the given core
+      case 'R':
+        RtSetup(atoi(optarg));
+        break;
+
+      // GPIO character device fast path
+      case 'L':
+        WaveSetLineChip(optarg);
+        break;
+
+      // SPI bitstream backend
+      case 'S':
+        WaveSetSpiDevice(optarg);
+        break;
+
+      // Transmitter GPIOs
+      case 'T':
+        if(!RouteSetTransmitters(optarg)) {
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      // Group allowed to submit to the transmitter
+      case 'g':
+        if(!RingSetGroup(optarg)) {
+          exit(EXIT_FAILURE);
+        }
+        break;
+
+      default:
+        exit(EXIT_FAILURE);
+    }
+  }
+
+  // Only the tuning mode creates a missing profile
+  if((profile != NULL) && !TimingLoad(profile, tune)) {
+    exit(EXIT_FAILURE);
+  }
+
+  start = RtNow();
+  CacheSetPolicy(ttl, force);
+
+  if(generate != NULL) {
+    return CatalogGenerate(generate, argc - optind, &argv[optind]) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if(batch) {
+    return RftxBatch(argv[0]);
+  }
+
+  if(serve) {
+    ServerRun(idle);
+  }
+
+  if(info) {
+    return RftxInfo();
+  }
+
+  if(cancel != NULL) {
+    return RftxCancel(strtoull(cancel, NULL, 10));
+  }
+
+  // Hand over the remaining arguments to the modules as if there were no options
+  argv[optind - 1] = argv[0];
+  argc -= optind - 1;
+  argv += optind - 1;
+
   // Provide help if asked for
   if(argc < 2) {
     printf("RFTX ("__DATE__" - "GIT_VERSION")\n");
+    printf(" %s [-v file.vcd] [-R cpu] [-T gpios] [-m map] [-c catalog] [-S spidev] [-L gpiochip] [-P profile] [-C cache [-t ttl] [-f]] [schedule] module arguments...\n", argv[0]);
+    printf(" %s [-v file.vcd] [-R cpu] [-T gpios] [-m map] [-c catalog] [-S spidev] [-L gpiochip] [-P profile] [-C cache [-t ttl] [-f]] -b < commands\n", argv[0]);
+    printf(" %s [-v file.vcd] [-R cpu] [-T gpios] [-m map] [-c catalog] [-S spidev] [-L gpiochip] [-P profile] [-C cache [-t ttl] [-f]] [-I idle] [-g group] -r\n", argv[0]);
+    printf(" %s -s [-p priority] [-d deadline] [schedule] module arguments...\n", argv[0]);
+    printf(" %s [-C cache] -i\n", argv[0]);
+    printf(" %s -x ticket\n", argv[0]);
+    printf(" %s -G catalog [module[=from-to]]...\n", argv[0]);
+    printf(" %s [-T gpio] -P profile -u module arguments...\n", argv[0]);
+    printf("  schedule: at <epoch seconds> | at m<monotonic seconds> | in <ms>\n");
+    printf("  air time: at most %u%% per transmitter within %u s, counted within one run: -b and -r carry the budget\n"
+           "      from command to command, a single command starts with a full one\n", AIRTIME_DUTY_CYCLE, AIRTIME_WINDOW);
+    printf("  -b: read commands (module arguments...) line by line from stdin, channels 1-4 of a code switched by the\n");
+    printf("      lines available at once are sent as one group telegram (plus corrections)\n");
+    printf("  -r: run the transmitter for commands submitted with -s\n");
+    printf("  -g: let the members of the group submit besides the owner of the transmitter\n");
+    printf("  -I: shut the library down after 'idle' seconds without transmission, 0 -> never (default %u)\n", IDLE_TIMEOUT);
+    printf("  -s: submit the command to the running transmitter and wait for it\n");
+    printf("  -p: priority of the submitted command (0-255, higher first)\n");
+    printf("  -x: cancel a submitted command, cutting off its transmission if it is on air (so does interrupting -s)\n");
+    printf("  -d: drop the submitted command if it can not be started within 'deadline' ms\n");
+    printf("  -i: show air time used and remaining budget of the running transmitter and the cache statistics\n");
+    printf("  -v: export the transmitted waveform into a VCD file\n");
+    printf("  -R: realtime mode on the given core, reports latency per command\n");
+    printf("  -T: comma separated GPIOs of the transmitters (default %u)\n", OUTPUT_PIN);
+    printf("  -m: reachability map, lines of: module code|* channel|* gpio[,gpio...]\n");
+    printf("  -G: precompile the telegrams of the modules (code range in hex) into a catalog file\n");
+    printf("  -c: transmit precompiled telegrams from a catalog file\n");
+    printf("  -C: skip commands that do not change the state of a device, remembered in a cache file\n");
+    printf("  -t: refresh states older than 'ttl' seconds with fewer repeats (default %u)\n", CACHE_TTL);
+    printf("  -f: send even if the device is known to be in that state\n");
+    printf("  -P: timing profile, lines of: module code|* channel|* short long pause repeats (µs)\n");
+    printf("  -u: find the shortest timing the device still reacts to (answer y/n on stdin) and store it in the profile\n");
+    printf("  -S: send a bitstream through a spidev device (MOSI) instead of pigpio, file:path writes it into a file\n");
+    printf("  -L: drive telegrams within the edge error tolerance from a thread through a gpiochip device, pigpio for the\n"
+           "      rest. file:path records the edges (deadline, driven [µs], gpio, level) in a file instead.\n");
+  }
+
+  if(!RftxParseSchedule(&argc, &argv, &scheduled)) {
+    exit(EXIT_FAILURE);
+  }
+
+  // Call Module parsers
+  switch(CommandParse(argc, argv, &command)) {
+    case ParseOk:
+      break;
+
+    case ParseInvalid:
+      exit(EXIT_FAILURE);
+
+    default:
+      return 0;
+  }
+
+  if(tune) {
+    if(profile == NULL) {
+      fprintf(stderr, "Tuning needs a profile (-P)!\n");
+      exit(EXIT_FAILURE);
+    }
+    return TimingTune(&command, profile) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if(submit) {
+    return RftxSubmit(&command, priority, scheduled, deadline);
   }
 
-  // Call Module handlers
-  Gt9000Handle(argc, argv);
-  Dmv7008Handle(argc, argv);
-  BorgaHandle(argc, argv);
+  // Encode and transmit
+  if(!CommandEncode(&command, &wave)) {
+    exit(EXIT_FAILURE);
+  }
+
+  // The device is already in that state
+  CacheActionType action = CacheFilter(&command, &wave);
+  if(action == CacheSkip) {
+    return 0;
+  }
+
+  // The budget is not kept between runs
+  AirtimeInit(RtNow());
+  if(!RftxRoute(&command, &wave, NULL, NULL)) {
+    exit(EXIT_FAILURE);
+  }
+  if(!RtThread() || !WaveStart()) {
+    exit(EXIT_FAILURE);
+  }
+
+  // Library is up: only the sleep is left before the scheduled time
+  if(scheduled) {
+    uint64_t now = RtNow();
+    if(scheduled > now) {
+      RtSleep((scheduled - now) / 1000000.0);
+    }
+    fprintf(stderr, "sched: on air %+lld µs from schedule\n", (long long) (RtNow() - scheduled));
+  }
+
+  bool sent = WaveTransmit(&wave);
+  WaveStop();
+
+  if(sent) {
+    RtReport(argv[1], start, WaveStarted());
+    CacheUpdate(&command, action);
+  }
 
-  return 0;
+  return sent ? 0 : EXIT_FAILURE;
 }
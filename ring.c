@@ -0,0 +1,310 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "ring.h"
+#include "rt.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <grp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Layout identifier
+#define RING_MAGIC          0x52465837
+
+// The slot index is taken from the lower bits of the ticket
+#define RING_MASK           (RING_SIZE - 1)
+
+#if (RING_SIZE & RING_MASK) != 0
+#error "RING_SIZE must be a power of two"
+#endif
+
+// Group of producers allowed to submit besides the owner (-1 -> the owner's)
+static gid_t ringGroup = (gid_t) -1;
+
+/***********************************************************************************************************************
+ * Set the group allowed to submit to the ring created by the consumer
+ **********************************************************************************************************************/
+bool RingSetGroup(const char *name)
+{
+  struct group *group;
+
+  if((group = getgrnam(name)) == NULL) {
+    fprintf(stderr, "%s: unknown group!\n", name);
+    return false;
+  }
+
+  ringGroup = group->gr_gid;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Map the ring, the consumer creates it if necessary
+ **********************************************************************************************************************/
+RingType *RingOpen(bool create)
+{
+  RingType *ring;
+  int fd;
+
+  if((fd = shm_open(RING_NAME, O_RDWR | (create ? O_CREAT : 0), RING_MODE)) < 0) {
+    perror(RING_NAME);
+    return NULL;
+  }
+
+  if(create) {
+    // Producers may run as a different user of the group
+    if(fchown(fd, (uid_t) -1, ringGroup) || fchmod(fd, RING_MODE) || ftruncate(fd, sizeof(RingType))) {
+      perror(RING_NAME);
+      close(fd);
+      return NULL;
+    }
+  }
+
+  ring = mmap(NULL, sizeof(RingType), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(ring == MAP_FAILED) {
+    perror(RING_NAME);
+    return NULL;
+  }
+
+  // Layout matches: records survive a restart of the consumer
+  if((__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) == RING_MAGIC) && (ring->size == RING_SIZE)) {
+    return ring;
+  }
+
+  if(!create) {
+    fprintf(stderr, "%s: transmitter not running!\n", RING_NAME);
+    munmap(ring, sizeof(RingType));
+    return NULL;
+  }
+
+  // Fresh ring: each slot waits for the ticket with its own index
+  memset(ring, 0, sizeof(RingType));
+  for(uint32_t i = 0; i < RING_SIZE; i++) {
+    ring->slots[i].sequence = i;
+  }
+  ring->size = RING_SIZE;
+  __atomic_store_n(&ring->magic, RING_MAGIC, __ATOMIC_RELEASE);
+
+  return ring;
+}
+
+/***********************************************************************************************************************
+ * Unmap the ring
+ **********************************************************************************************************************/
+void RingClose(RingType *ring)
+{
+  munmap(ring, sizeof(RingType));
+}
+
+/***********************************************************************************************************************
+ * Futex operation on the event counter (shared between processes)
+ **********************************************************************************************************************/
+static long RingFutex(RingType *ring, int op, uint32_t value, const struct timespec *timeout)
+{
+  return syscall(SYS_futex, &ring->events, op, value, timeout, NULL, 0);
+}
+
+/***********************************************************************************************************************
+ * Signal an event to the consumer, only enter the kernel if it is sleeping
+ **********************************************************************************************************************/
+void RingWakeUp(RingType *ring)
+{
+  __atomic_add_fetch(&ring->events, 1, __ATOMIC_SEQ_CST);
+  if(__atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST)) {
+    RingFutex(ring, FUTEX_WAKE, 1, NULL);
+  }
+}
+
+/***********************************************************************************************************************
+ * Submit a record without locking or blocking, returns its ticket or -1 if the ring is full
+ **********************************************************************************************************************/
+int64_t RingSubmit(RingType *ring, const RingRecordType *record)
+{
+  uint64_t ticket = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+  RingSlotType *slot;
+
+  // Claim a slot
+  for(;;) {
+    slot = &ring->slots[ticket & RING_MASK];
+    int64_t diff = (int64_t) (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - ticket);
+
+    if(diff == 0) {
+      // Slot is free for this ticket, try to take it
+      if(__atomic_compare_exchange_n(&ring->head, &ticket, ticket + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    }
+    else if(diff < 0) {
+      // Still occupied from the previous round
+      return -1;
+    }
+    else {
+      // Another producer was faster
+      ticket = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    }
+  }
+
+  // Fill and publish it
+  slot->record = *record;
+  __atomic_store_n(&ring->status[ticket & RING_MASK], (ticket << 8) | RingSubmitted, __ATOMIC_RELAXED);
+  __atomic_store_n(&slot->sequence, ticket + 1, __ATOMIC_RELEASE);
+
+  RingWakeUp(ring);
+
+  return ticket;
+}
+
+/***********************************************************************************************************************
+ * Get the completion status of a ticket
+ **********************************************************************************************************************/
+RingStatusType RingStatus(RingType *ring, uint64_t ticket)
+{
+  uint64_t status = __atomic_load_n(&ring->status[ticket & RING_MASK], __ATOMIC_ACQUIRE);
+
+  // The slot has been reused since
+  if((status >> 8) != (ticket & (UINT64_MAX >> 8))) {
+    return RingUnknown;
+  }
+
+  return status & 0xFF;
+}
+
+/***********************************************************************************************************************
+ * Ask the consumer to cancel a submitted record, returns false if it is already completed
+ **********************************************************************************************************************/
+bool RingCancel(RingType *ring, uint64_t ticket)
+{
+  if(RingStatus(ring, ticket) != RingSubmitted) {
+    return false;
+  }
+
+  __atomic_store_n(&ring->cancel[ticket & RING_MASK], ticket + 1, __ATOMIC_RELEASE);
+  __atomic_add_fetch(&ring->cancels, 1, __ATOMIC_SEQ_CST);
+  RingWakeUp(ring);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Take the next record (consumer only), returns false if the ring is empty
+ **********************************************************************************************************************/
+bool RingReceive(RingType *ring, RingRecordType *record, uint64_t *ticket)
+{
+  uint64_t tail = ring->tail;
+  RingSlotType *slot = &ring->slots[tail & RING_MASK];
+
+  // Not yet published
+  if(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != tail + 1) {
+    return false;
+  }
+
+  *record = slot->record;
+  *ticket = tail;
+
+  // Hand the slot over to the producers of the next round
+  __atomic_store_n(&slot->sequence, tail + RING_SIZE, __ATOMIC_RELEASE);
+  __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Set the completion status of a ticket (consumer only)
+ **********************************************************************************************************************/
+void RingComplete(RingType *ring, uint64_t ticket, RingStatusType status)
+{
+  uint64_t expected = (ticket << 8) | RingSubmitted;
+
+  // Don't overwrite the status of a newer record in the same slot
+  __atomic_compare_exchange_n(&ring->status[ticket & RING_MASK], &expected, (ticket << 8) | status, false,
+    __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+/***********************************************************************************************************************
+ * Take the tickets to be cancelled (consumer only), 'tickets' has room for RING_SIZE. Returns their number.
+ **********************************************************************************************************************/
+uint32_t RingCancelRequests(RingType *ring, uint64_t tickets[])
+{
+  uint32_t cancels = __atomic_load_n(&ring->cancels, __ATOMIC_SEQ_CST), count = 0;
+
+  // Nothing new
+  if(cancels == ring->cancelsTaken) {
+    return 0;
+  }
+  ring->cancelsTaken = cancels;
+
+  for(uint32_t i = 0; i < RING_SIZE; i++) {
+    uint64_t ticket = __atomic_exchange_n(&ring->cancel[i], 0, __ATOMIC_ACQUIRE);
+    if(ticket) {
+      tickets[count++] = ticket - 1;
+    }
+  }
+
+  return count;
+}
+
+/***********************************************************************************************************************
+ * Announce that the consumer is going to sleep, returns the event counter to wait on
+ **********************************************************************************************************************/
+uint32_t RingEvents(RingType *ring)
+{
+  __atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+
+  return __atomic_load_n(&ring->events, __ATOMIC_SEQ_CST);
+}
+
+/***********************************************************************************************************************
+ * Sleep until the event counter differs from 'events' or 'timeout' [µs] has passed (0 -> forever)
+ **********************************************************************************************************************/
+void RingWait(RingType *ring, uint32_t events, uint64_t timeout)
+{
+  struct timespec relative = { timeout / 1000000, (timeout % 1000000) * 1000 };
+
+  if((RingFutex(ring, FUTEX_WAIT, events, timeout ? &relative : NULL) < 0) &&
+     (errno != EAGAIN) && (errno != EINTR) && (errno != ETIMEDOUT)) {
+    perror("RingWait()");
+  }
+
+  __atomic_store_n(&ring->waiting, 0, __ATOMIC_SEQ_CST);
+}
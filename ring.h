@@ -0,0 +1,128 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef RING_H_
+#define RING_H_
+
+#include "config.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "command.h"
+
+// Fixed size command record
+typedef struct {
+  CommandType command;
+  // Higher priorities are transmitted first
+  uint8_t priority;
+  // Scheduled start of the transmission, CLOCK_MONOTONIC [µs] (0 -> immediately)
+  uint64_t start;
+  // Latest start of the transmission, CLOCK_MONOTONIC [µs] (0 -> none)
+  uint64_t deadline;
+} RingRecordType;
+
+// Completion status of a record
+typedef enum {
+  RingUnknown = 0,
+  RingSubmitted,
+  RingDone,
+  RingExpired,
+  RingInvalid,
+  RingRejected,
+  RingCancelled,
+  RingFailed
+} RingStatusType;
+
+// One slot of the ring, the sequence tells who owns it
+typedef struct {
+  uint64_t sequence;
+  RingRecordType record;
+} RingSlotType;
+
+// Transmitter statistics, published by the consumer
+typedef struct {
+  // Time of the last update, CLOCK_MONOTONIC [µs]
+  uint64_t updated;
+  // Transmitters, one bit per GPIO
+  uint32_t pins;
+  // Air time used and remaining air time budget per pin [µs]
+  uint64_t airtime[WAVE_MAX_PIN + 1];
+  uint64_t budget[WAVE_MAX_PIN + 1];
+  // Library up, idle timeout [s] and time it took to come up the last time [µs]
+  uint32_t active;
+  uint32_t idleTimeout;
+  uint64_t startup;
+  // Time to the first edge from idle with the library up (warm) or brought up (cold): count, average and maximum [µs]
+  uint32_t warmCount, coldCount;
+  uint64_t warmAverage, coldAverage;
+  uint64_t warmMax, coldMax;
+} RingStatsType;
+
+// Shared memory layout
+typedef struct {
+  uint32_t magic;
+  uint32_t size;
+  // Next ticket for the producers
+  uint64_t head __attribute__((aligned(64)));
+  // Next ticket for the consumer
+  uint64_t tail __attribute__((aligned(64)));
+  // Futex word, incremented on every event, and whether the consumer is about to sleep on it
+  uint32_t events __attribute__((aligned(64)));
+  uint32_t waiting;
+  RingSlotType slots[RING_SIZE] __attribute__((aligned(64)));
+  // Ticket (upper 56 bits) and status (lower 8 bits) of the last record in each slot
+  uint64_t status[RING_SIZE];
+  // Cancel requests: ticket + 1 per slot (0 -> none), their number and the number taken by the consumer
+  uint64_t cancel[RING_SIZE];
+  uint32_t cancels;
+  uint32_t cancelsTaken;
+  RingStatsType stats __attribute__((aligned(64)));
+} RingType;
+
+bool RingSetGroup(const char *name);
+RingType *RingOpen(bool create);
+void RingClose(RingType *ring);
+
+int64_t RingSubmit(RingType *ring, const RingRecordType *record);
+RingStatusType RingStatus(RingType *ring, uint64_t ticket);
+bool RingCancel(RingType *ring, uint64_t ticket);
+
+bool RingReceive(RingType *ring, RingRecordType *record, uint64_t *ticket);
+void RingComplete(RingType *ring, uint64_t ticket, RingStatusType status);
+uint32_t RingCancelRequests(RingType *ring, uint64_t tickets[]);
+uint32_t RingEvents(RingType *ring);
+void RingWait(RingType *ring, uint32_t events, uint64_t timeout);
+void RingWakeUp(RingType *ring);
+
+#endif // RING_H_
@@ -0,0 +1,186 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "route.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "airtime.h"
+#include "wave.h"
+
+// Devices reachable from the transmitters in 'pins'
+typedef struct {
+  CommandDeviceType device;
+  uint32_t pins;
+} RouteEntryType;
+
+static uint32_t routeTransmitters = 1U << OUTPUT_PIN;
+static RouteEntryType routeEntries[ROUTE_MAX_ENTRIES];
+static uint32_t routeNumEntries = 0;
+
+/***********************************************************************************************************************
+ * Parse a comma separated list of GPIOs into a pin mask (0 -> invalid)
+ **********************************************************************************************************************/
+static uint32_t RouteParsePins(const char *list)
+{
+  uint32_t pins = 0;
+  char *end;
+
+  do {
+    long pin = strtol(list, &end, 10);
+    if((end == list) || (pin < 0) || (pin > WAVE_MAX_PIN) || ((*end != ',') && (*end != '\0'))) {
+      return 0;
+    }
+    pins |= 1U << pin;
+    list = end + 1;
+  } while(*end == ',');
+
+  return pins;
+}
+
+/***********************************************************************************************************************
+ * Set the transmitters from a comma separated list of GPIOs
+ **********************************************************************************************************************/
+bool RouteSetTransmitters(const char *list)
+{
+  uint32_t pins = RouteParsePins(list);
+
+  if(pins == 0) {
+    fprintf(stderr, "%s: invalid transmitter list!\n", list);
+    return false;
+  }
+
+  routeTransmitters = pins;
+  WaveSetPins(pins);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Load the reachability map: one "module code channel gpio[,gpio...]" line per device, code (hex) and channel as on
+ * the command line or '*' for any. The first matching line counts, unlisted devices are reachable from everywhere.
+ **********************************************************************************************************************/
+bool RouteLoad(const char *fileName)
+{
+  char line[BATCH_LINE_LENGTH];
+  uint32_t lineNumber = 0;
+  FILE *file;
+
+  if((file = fopen(fileName, "r")) == NULL) {
+    perror(fileName);
+    return false;
+  }
+
+  while(fgets(line, sizeof(line), file) != NULL) {
+    char *module = strtok(line, " \t\r\n"), *code = strtok(NULL, " \t\r\n");
+    char *channel = strtok(NULL, " \t\r\n"), *pins = strtok(NULL, " \t\r\n");
+    RouteEntryType *entry = &routeEntries[routeNumEntries];
+
+    lineNumber++;
+
+    // Skip empty lines and comments
+    if((module == NULL) || (module[0] == '#')) {
+      continue;
+    }
+
+    if(routeNumEntries >= ROUTE_MAX_ENTRIES) {
+      fprintf(stderr, "%s:%u: too many devices!\n", fileName, lineNumber);
+      fclose(file);
+      return false;
+    }
+
+    if(!CommandParseDevice(module, code, channel, &entry->device) || (pins == NULL) ||
+       ((entry->pins = RouteParsePins(pins)) == 0)) {
+      fprintf(stderr, "%s:%u: invalid device!\n", fileName, lineNumber);
+      fclose(file);
+      return false;
+    }
+    routeNumEntries++;
+  }
+
+  fclose(file);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Get the transmitters, one bit per GPIO
+ **********************************************************************************************************************/
+uint32_t RouteTransmitters(void)
+{
+  return routeTransmitters;
+}
+
+/***********************************************************************************************************************
+ * Get the transmitters that reach the device of a command, one bit per GPIO (0 -> none)
+ **********************************************************************************************************************/
+uint32_t RouteReachable(const CommandType *command)
+{
+  for(uint32_t i = 0; i < routeNumEntries; i++) {
+    if(CommandMatchDevice(&routeEntries[i].device, command)) {
+      return routeEntries[i].pins & routeTransmitters;
+    }
+  }
+
+  return routeTransmitters;
+}
+
+/***********************************************************************************************************************
+ * Select the transmitter among 'pins' with the least air time [µs] queued on it in 'load' (NULL -> nothing queued)
+ * that has the air time budget for 'airtime' [µs], the one used least so far among equally busy ones. Returns
+ * ROUTE_NONE if none has and the time until the first one has in 'wait' [µs].
+ **********************************************************************************************************************/
+uint32_t RouteSelect(uint32_t pins, uint64_t airtime, const uint64_t load[], uint64_t now, uint64_t *wait)
+{
+  uint32_t select = ROUTE_NONE;
+
+  for(uint32_t pin = 0; pin <= WAVE_MAX_PIN; pin++) {
+    if(!(pins & (1U << pin))) {
+      continue;
+    }
+    uint64_t delay = AirtimeDelay(pin, airtime, now);
+    if(delay) {
+      *wait = (delay < *wait) ? delay : *wait;
+    }
+    else if((select == ROUTE_NONE) ||
+            ((load != NULL) && (load[pin] < load[select])) ||
+            (((load == NULL) || (load[pin] == load[select])) && (AirtimeUsed(pin) < AirtimeUsed(select)))) {
+      select = pin;
+    }
+  }
+
+  return select;
+}
@@ -0,0 +1,192 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#define _GNU_SOURCE
+#include "config.h"
+#include "rt.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+// Realtime mode enabled and the core of the realtime threads
+static bool rtEnabled = false;
+static int rtCpu;
+
+// Largest scheduling delay since the last report [µs]
+static uint64_t rtMaxLate = 0;
+
+// Page fault counters at the last report
+static long rtMinorFaults = 0;
+static long rtMajorFaults = 0;
+
+/***********************************************************************************************************************
+ * Touch the stack once so that it is mapped before mlockall() pins it
+ **********************************************************************************************************************/
+static void RtPrefaultStack(void)
+{
+  volatile uint8_t stack[RT_STACK_PREFAULT];
+
+  memset((uint8_t *) stack, 0, sizeof(stack));
+}
+
+/***********************************************************************************************************************
+ * Enter realtime mode: lock all memory and run the transmitting thread on 'cpu' (see RtThread())
+ **********************************************************************************************************************/
+void RtSetup(int cpu)
+{
+  RtPrefaultStack();
+
+  // No page faults in the transmit path
+  if(mlockall(MCL_CURRENT | MCL_FUTURE)) {
+    perror("mlockall()");
+    exit(EXIT_FAILURE);
+  }
+  rtCpu = cpu;
+
+  // Start counting from here
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  rtMinorFaults = usage.ru_minflt;
+  rtMajorFaults = usage.ru_majflt;
+
+  rtEnabled = true;
+}
+
+/***********************************************************************************************************************
+ * In realtime mode: pin the calling thread to the chosen core and run it with SCHED_FIFO, the rest of the process
+ * stays as it is. Returns false on failure.
+ **********************************************************************************************************************/
+bool RtThread(void)
+{
+  struct sched_param param = { .sched_priority = RT_PRIORITY };
+  cpu_set_t cpus;
+  int error;
+
+  if(!rtEnabled) {
+    return true;
+  }
+
+  // Pin to the chosen core
+  CPU_ZERO(&cpus);
+  CPU_SET(rtCpu, &cpus);
+  if((error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus))) {
+    fprintf(stderr, "pthread_setaffinity_np(): %s\n", strerror(error));
+    return false;
+  }
+
+  // Run before everything else on that core
+  if((error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))) {
+    fprintf(stderr, "pthread_setschedparam(): %s\n", strerror(error));
+    return false;
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Realtime mode enabled?
+ **********************************************************************************************************************/
+bool RtEnabled(void)
+{
+  return rtEnabled;
+}
+
+/***********************************************************************************************************************
+ * Current CLOCK_MONOTONIC time [µs], the same in all processes
+ **********************************************************************************************************************/
+uint64_t RtNow(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/***********************************************************************************************************************
+ * Record a scheduling delay (how late a thread woke up) [µs]
+ **********************************************************************************************************************/
+void RtLate(uint64_t lateness)
+{
+  uint64_t max = __atomic_load_n(&rtMaxLate, __ATOMIC_RELAXED);
+
+  while((lateness > max) &&
+        !__atomic_compare_exchange_n(&rtMaxLate, &max, lateness, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+/***********************************************************************************************************************
+ * Sleep until an absolute deadline and record how late we woke up
+ **********************************************************************************************************************/
+void RtSleep(double seconds)
+{
+  struct timespec deadline;
+  uint64_t end;
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  end = (uint64_t) deadline.tv_sec * 1000000 + deadline.tv_nsec / 1000 + (uint64_t) (seconds * 1000000);
+  deadline.tv_sec = end / 1000000;
+  deadline.tv_nsec = (end % 1000000) * 1000;
+
+  // Only a signal interrupts it early
+  while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR);
+
+  RtLate(RtNow() - end);
+}
+
+/***********************************************************************************************************************
+ * Report the latency from 'start' to 'started' (the transmission), page faults and the largest scheduling delay since
+ * the last report
+ **********************************************************************************************************************/
+void RtReport(const char *what, uint64_t start, uint64_t started)
+{
+  struct rusage usage;
+
+  if(!rtEnabled) {
+    return;
+  }
+
+  getrusage(RUSAGE_SELF, &usage);
+  long minorFaults = __atomic_exchange_n(&rtMinorFaults, usage.ru_minflt, __ATOMIC_RELAXED);
+  long majorFaults = __atomic_exchange_n(&rtMajorFaults, usage.ru_majflt, __ATOMIC_RELAXED);
+
+  fprintf(stderr, "rt: %s latency %llu µs, page faults %ld/%ld, scheduling delay %llu µs\n", what,
+    (unsigned long long) (started - start), usage.ru_minflt - minorFaults, usage.ru_majflt - majorFaults,
+    (unsigned long long) __atomic_exchange_n(&rtMaxLate, 0, __ATOMIC_RELAXED));
+}
@@ -0,0 +1,227 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "sched.h"
+
+#include <stdlib.h>
+
+// Hierarchical timer wheel: 4 levels of 64 slots, each level covers 64 times the range of the one below
+#define SCHED_LEVELS               4
+#define SCHED_BITS                 6
+#define SCHED_SLOTS                (1 << SCHED_BITS)
+#define SCHED_MASK                 (SCHED_SLOTS - 1)
+#define SCHED_RANGE                (1ULL << (SCHED_LEVELS * SCHED_BITS))
+
+// Slot lists (circular, the slot itself is the list head)
+static SchedTimerType schedWheel[SCHED_LEVELS][SCHED_SLOTS];
+
+// Next tick to be processed
+static uint64_t schedNow = 0;
+
+// Number of timers in the wheel
+static uint32_t schedCount = 0;
+
+/***********************************************************************************************************************
+ * Convert µs to ticks
+ **********************************************************************************************************************/
+static uint64_t SchedTicks(uint64_t time)
+{
+  return time / SCHED_TICK;
+}
+
+/***********************************************************************************************************************
+ * Link a timer into the slot it belongs to, relative to the current tick
+ **********************************************************************************************************************/
+static void SchedInsert(SchedTimerType *timer)
+{
+  uint64_t due = (timer->due < schedNow) ? schedNow : timer->due;
+  uint64_t distance = due - schedNow;
+  SchedTimerType *slot;
+  uint32_t level;
+
+  // Too far away: park it at the end of the top level, it will be cascaded and parked again
+  if(distance >= SCHED_RANGE) {
+    due = schedNow + SCHED_RANGE - 1;
+    distance = SCHED_RANGE - 1;
+  }
+
+  for(level = 0; (level < SCHED_LEVELS - 1) && (distance >= (1ULL << ((level + 1) * SCHED_BITS))); level++);
+  slot = &schedWheel[level][(due >> (level * SCHED_BITS)) & SCHED_MASK];
+
+  timer->prev = slot->prev;
+  timer->next = slot;
+  slot->prev->next = timer;
+  slot->prev = timer;
+}
+
+/***********************************************************************************************************************
+ * Unlink a timer from its slot
+ **********************************************************************************************************************/
+static void SchedUnlink(SchedTimerType *timer)
+{
+  timer->prev->next = timer->next;
+  timer->next->prev = timer->prev;
+  timer->next = timer->prev = NULL;
+}
+
+/***********************************************************************************************************************
+ * Initialize the wheel at 'now' [µs]
+ **********************************************************************************************************************/
+void SchedInit(uint64_t now)
+{
+  for(uint32_t level = 0; level < SCHED_LEVELS; level++) {
+    for(uint32_t slot = 0; slot < SCHED_SLOTS; slot++) {
+      schedWheel[level][slot].next = schedWheel[level][slot].prev = &schedWheel[level][slot];
+    }
+  }
+
+  schedNow = SchedTicks(now);
+  schedCount = 0;
+}
+
+/***********************************************************************************************************************
+ * Schedule a timer for 'due' [µs]
+ **********************************************************************************************************************/
+void SchedAdd(SchedTimerType *timer, uint64_t due)
+{
+  // Never expire early
+  timer->due = SchedTicks(due + SCHED_TICK - 1);
+  SchedInsert(timer);
+  schedCount++;
+}
+
+/***********************************************************************************************************************
+ * Remove a scheduled timer before it expires
+ **********************************************************************************************************************/
+void SchedCancel(SchedTimerType *timer)
+{
+  if(timer->next != NULL) {
+    SchedUnlink(timer);
+    schedCount--;
+  }
+}
+
+/***********************************************************************************************************************
+ * Move all timers of a slot one level down
+ **********************************************************************************************************************/
+static void SchedCascade(uint32_t level)
+{
+  SchedTimerType *slot = &schedWheel[level][(schedNow >> (level * SCHED_BITS)) & SCHED_MASK];
+
+  while(slot->next != slot) {
+    SchedTimerType *timer = slot->next;
+    SchedUnlink(timer);
+    SchedInsert(timer);
+  }
+}
+
+/***********************************************************************************************************************
+ * Advance the wheel to 'now' [µs], returns the expired timers in order of expiry (linked by 'next', NULL terminated)
+ **********************************************************************************************************************/
+SchedTimerType *SchedExpire(uint64_t now)
+{
+  SchedTimerType *first = NULL, **last = &first;
+  uint64_t ticks = SchedTicks(now);
+
+  while(schedNow <= ticks) {
+    // Nothing to do: jump
+    if(schedCount == 0) {
+      schedNow = ticks + 1;
+      break;
+    }
+
+    // Refill the lower levels at their wrap-around
+    for(uint32_t level = 1; level < SCHED_LEVELS; level++) {
+      if(schedNow & ((1ULL << (level * SCHED_BITS)) - 1)) {
+        break;
+      }
+      SchedCascade(level);
+    }
+
+    // Collect this tick
+    SchedTimerType *slot = &schedWheel[0][schedNow & SCHED_MASK];
+    while(slot->next != slot) {
+      SchedTimerType *timer = slot->next;
+      SchedUnlink(timer);
+      schedCount--;
+      *last = timer;
+      last = &timer->next;
+    }
+
+    schedNow++;
+  }
+
+  *last = NULL;
+
+  return first;
+}
+
+/***********************************************************************************************************************
+ * Time [µs] at which SchedExpire() has to be called next, UINT64_MAX if the wheel is empty
+ **********************************************************************************************************************/
+uint64_t SchedNext(void)
+{
+  uint64_t next = UINT64_MAX;
+
+  if(schedCount == 0) {
+    return next;
+  }
+
+  // Timers in the lowest level expire in their slot, the others are due when their slot is cascaded
+  for(uint32_t level = 0; level < SCHED_LEVELS; level++) {
+    uint32_t shift = level * SCHED_BITS;
+    // First slot boundary not yet processed
+    uint64_t first = (schedNow + (1ULL << shift) - 1) >> shift;
+    for(uint64_t i = 0; i < SCHED_SLOTS; i++) {
+      uint64_t tick = (first + i) << shift;
+      SchedTimerType *slot = &schedWheel[level][(first + i) & SCHED_MASK];
+      if(slot->next != slot) {
+        if(tick < next) {
+          next = tick;
+        }
+        break;
+      }
+    }
+  }
+
+  return next * SCHED_TICK;
+}
+
+/***********************************************************************************************************************
+ * Number of scheduled timers
+ **********************************************************************************************************************/
+uint32_t SchedCount(void)
+{
+  return schedCount;
+}
@@ -0,0 +1,693 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "server.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ring.h"
+#include "rt.h"
+#include "sched.h"
+#include "airtime.h"
+#include "route.h"
+#include "cache.h"
+#include "command.h"
+#include "wave.h"
+#include "telegram.h"
+#include "fuse.h"
+
+// Records taken from the ring, waiting for the transmitter
+typedef struct {
+  RingRecordType record;
+  uint64_t ticket;
+  // Time of reception [µs]
+  uint64_t received;
+  // Air time of the transmission [µs]
+  uint64_t airtime;
+  // Transmitters reaching the device
+  uint32_t pins;
+  // Records of other channels carried out by the same group telegram
+  uint64_t joined[COMMAND_ALL_CHANNELS - 1];
+  uint32_t numJoined;
+} ServerPendingType;
+
+// Records waiting for their scheduled time
+typedef struct {
+  SchedTimerType timer;
+  ServerPendingType pending;
+  bool used;
+} ServerScheduledType;
+
+// Transmission being composed: its telegrams and the time each transmitter is busy with them [µs]
+typedef struct {
+  RftxTelegramType *first, **last;
+  uint32_t count;
+  uint64_t load[WAVE_MAX_PIN + 1];
+  uint64_t length;
+} ServerWaveType;
+
+static RingType *serverRing;
+
+// Records taken from the ring but not yet transmitted
+static ServerPendingType serverPending[RING_SIZE];
+static uint32_t serverNumPending = 0;
+
+// Scheduled records and the free ones among them
+static ServerScheduledType serverScheduled[SCHED_MAX];
+static uint32_t serverFree[SCHED_MAX];
+static uint32_t serverNumFree = 0;
+
+// Scheduled records that are due, in order of their scheduled time
+static ServerPendingType serverDue[SCHED_MAX];
+static uint32_t serverNumDue = 0;
+
+// Telegrams handed over to the transmitter and their records
+static RftxTelegramType serverTelegrams[SERVER_TELEGRAMS];
+static uint64_t serverTickets[SERVER_TELEGRAMS][COMMAND_ALL_CHANNELS];
+static uint32_t serverNumTickets[SERVER_TELEGRAMS];
+static uint64_t serverReceived[SERVER_TELEGRAMS];
+static uint64_t serverStart[SERVER_TELEGRAMS];
+static CacheActionType serverActions[SERVER_TELEGRAMS];
+
+// Cancel requests for records still in the ring: ticket + 1 in the slot of the ticket (0 -> none)
+static uint64_t serverCancels[RING_SIZE];
+
+/***********************************************************************************************************************
+ * Completion callback (transmitter thread)
+ **********************************************************************************************************************/
+static void ServerDone(RftxTelegramType *telegram, void *context)
+{
+  uint32_t t = telegram - serverTelegrams;
+
+  static const RingStatusType statuses[] = {
+    [TelegramDone] = RingDone, [TelegramCancelled] = RingCancelled, [TelegramFailed] = RingFailed
+  };
+
+  // Only what has been sent out changes the state of the devices
+  if(telegram->result == TelegramDone) {
+    CacheUpdate(&telegram->command, serverActions[t]);
+  }
+
+  for(uint32_t i = 0; i < serverNumTickets[t]; i++) {
+    RingComplete(serverRing, serverTickets[t][i], statuses[telegram->result]);
+  }
+
+  // Precision of scheduled transmissions
+  if(serverStart[t] && (telegram->result == TelegramDone)) {
+    fprintf(stderr, "sched: ticket %llu on air %+lld µs from schedule\n", (unsigned long long) serverTickets[t][0],
+      (long long) (telegram->started - serverStart[t]));
+  }
+
+  if(RtEnabled() && (telegram->result == TelegramDone)) {
+    char what[32];
+    snprintf(what, sizeof(what), "ticket %llu", (unsigned long long) serverTickets[t][0]);
+    RtReport(what, serverReceived[t], telegram->started);
+  }
+
+  // The transmitter has room for the next one
+  RingWakeUp(serverRing);
+}
+
+/***********************************************************************************************************************
+ * Air time a record is going to take [µs] (0 -> invalid, it is rejected when it is prepared)
+ **********************************************************************************************************************/
+static uint64_t ServerAirtime(const RingRecordType *record)
+{
+  static WaveType wave;
+
+  return CommandEncode(&record->command, &wave) ? WaveAirtime(&wave) : 0;
+}
+
+/***********************************************************************************************************************
+ * Complete a record and the ones joined to it
+ **********************************************************************************************************************/
+static void ServerComplete(const ServerPendingType *pending, RingStatusType status)
+{
+  RingComplete(serverRing, pending->ticket, status);
+  for(uint32_t i = 0; i < pending->numJoined; i++) {
+    RingComplete(serverRing, pending->joined[i], status);
+  }
+}
+
+/***********************************************************************************************************************
+ * Join the records switching the other channels of the code of list[index] to the same state, due at the same time,
+ * into one group telegram. They are removed from the list, returns the new index of the group record.
+ **********************************************************************************************************************/
+static uint32_t ServerFuse(ServerPendingType list[], uint32_t *count, uint32_t index)
+{
+  CommandType commands[COMMAND_ALL_CHANNELS + 1];
+  uint32_t members[COMMAND_ALL_CHANNELS + 1], n = 0, kept = 0, group = index;
+  ServerPendingType *pending = &list[index];
+  FuseType fused[COMMAND_ALL_CHANNELS + 1];
+
+  // More than one record per channel is not fused anyway
+  for(uint32_t i = index; (i < *count) && (n <= COMMAND_ALL_CHANNELS); i++) {
+    if((list[i].record.command.module == pending->record.command.module) &&
+       (list[i].record.command.code == pending->record.command.code) &&
+       (list[i].record.start / SCHED_TICK == pending->record.start / SCHED_TICK)) {
+      members[n] = i;
+      commands[n++] = list[i].record.command;
+    }
+  }
+
+  // One telegram for all of them
+  if((n != COMMAND_ALL_CHANNELS) || (FuseCommands(commands, n, false, fused) != 1)) {
+    return index;
+  }
+
+  fprintf(stderr, "fuse: %u records of %s %X in one telegram\n", n, CommandName(&pending->record.command),
+    pending->record.command.code);
+
+  // The group is as urgent as the most urgent one of them
+  for(uint32_t m = 1; m < n; m++) {
+    ServerPendingType *member = &list[members[m]];
+    uint64_t ticket = member->ticket;
+    if(ticket < pending->ticket) {
+      member->ticket = pending->ticket;
+      pending->ticket = ticket;
+    }
+    pending->joined[pending->numJoined++] = member->ticket;
+    pending->received = (member->received < pending->received) ? member->received : pending->received;
+    pending->record.priority = (member->record.priority > pending->record.priority) ?
+      member->record.priority : pending->record.priority;
+    if(member->record.deadline && (!pending->record.deadline || (member->record.deadline < pending->record.deadline))) {
+      pending->record.deadline = member->record.deadline;
+    }
+  }
+  pending->record.command = fused[0].command;
+  pending->airtime = ServerAirtime(&pending->record);
+  pending->pins = RouteReachable(&pending->record.command);
+
+  // Drop the joined ones keeping the order
+  for(uint32_t i = 0, m = 1; i < *count; i++) {
+    if((m < n) && (i == members[m])) {
+      m++;
+      continue;
+    }
+    group = (i == index) ? kept : group;
+    list[kept++] = list[i];
+  }
+  *count = kept;
+
+  return group;
+}
+
+/***********************************************************************************************************************
+ * Fuse the records of a list into group telegrams where possible
+ **********************************************************************************************************************/
+static void ServerFuseAll(ServerPendingType list[], uint32_t *count)
+{
+  for(uint32_t i = 0; i < *count; i++) {
+    i = ServerFuse(list, count, i);
+  }
+}
+
+/***********************************************************************************************************************
+ * Get a telegram that is not in use by the transmitter
+ **********************************************************************************************************************/
+static uint32_t ServerTelegram(void)
+{
+  for(uint32_t i = 0; i < SERVER_TELEGRAMS; i++) {
+    TelegramStateType state = RftxState(&serverTelegrams[i]);
+    if((state == TelegramIdle) || (state == TelegramDone) || (state == TelegramCancelled) ||
+       (state == TelegramFailed)) {
+      return i;
+    }
+  }
+
+  return SERVER_TELEGRAMS;
+}
+
+/***********************************************************************************************************************
+ * Encode a record into a free telegram, returns SERVER_TELEGRAMS if it is not to be transmitted
+ **********************************************************************************************************************/
+static uint32_t ServerPrepare(const ServerPendingType *pending)
+{
+  uint32_t t = ServerTelegram();
+
+  if(t >= SERVER_TELEGRAMS) {
+    return t;
+  }
+
+  // Too late
+  if(pending->record.deadline && (RtNow() > pending->record.deadline)) {
+    ServerComplete(pending, RingExpired);
+    return SERVER_TELEGRAMS;
+  }
+
+  // Records are not trusted
+  if(!RftxPrepare(&serverTelegrams[t], &pending->record.command)) {
+    ServerComplete(pending, RingInvalid);
+    return SERVER_TELEGRAMS;
+  }
+
+  // The device is already in that state
+  if((serverActions[t] = CacheFilter(&pending->record.command, &serverTelegrams[t].wave)) == CacheSkip) {
+    ServerComplete(pending, RingDone);
+    return SERVER_TELEGRAMS;
+  }
+
+  serverTickets[t][0] = pending->ticket;
+  memcpy(&serverTickets[t][1], pending->joined, pending->numJoined * sizeof(pending->joined[0]));
+  serverNumTickets[t] = pending->numJoined + 1;
+  serverReceived[t] = pending->received;
+  serverStart[t] = pending->record.start;
+  // Reserve it until it is submitted
+  serverTelegrams[t].state = TelegramQueued;
+
+  return t;
+}
+
+/***********************************************************************************************************************
+ * Transmitters that can take a telegram of 'airtime' [µs] without making the transmission longer. Idle ones can
+ * always take one.
+ **********************************************************************************************************************/
+static uint32_t ServerIdle(const ServerWaveType *wave, uint64_t airtime)
+{
+  uint32_t pins = 0;
+
+  for(uint32_t pin = 0; pin <= WAVE_MAX_PIN; pin++) {
+    if((wave->load[pin] == 0) || (wave->load[pin] + airtime <= wave->length)) {
+      pins |= 1U << pin;
+    }
+  }
+
+  return pins & RouteTransmitters();
+}
+
+/***********************************************************************************************************************
+ * Add a prepared telegram to the transmission on the given transmitter
+ **********************************************************************************************************************/
+static void ServerAppend(ServerWaveType *wave, uint32_t t, uint32_t pin, uint64_t now)
+{
+  RftxTelegramType *telegram = &serverTelegrams[t];
+  uint64_t airtime = WaveAirtime(&telegram->wave);
+
+  telegram->wave.pin = pin;
+  AirtimeCharge(pin, airtime, now);
+  wave->load[pin] += airtime;
+  wave->length = (wave->load[pin] > wave->length) ? wave->load[pin] : wave->length;
+
+  *wave->last = telegram;
+  wave->last = &telegram->chained;
+  wave->count++;
+}
+
+/***********************************************************************************************************************
+ * Submit the composed transmission
+ **********************************************************************************************************************/
+static void ServerSubmit(ServerWaveType *wave)
+{
+  if(wave->first != NULL) {
+    for(RftxTelegramType *telegram = wave->first; telegram != NULL; telegram = telegram->chained) {
+      telegram->state = TelegramIdle;
+    }
+    if(!RftxSubmit(wave->first, ServerDone, NULL)) {
+      // Not taken, completed here
+      for(RftxTelegramType *telegram = wave->first; telegram != NULL; telegram = telegram->chained) {
+        telegram->result = TelegramFailed;
+        ServerDone(telegram, NULL);
+        telegram->state = TelegramFailed;
+      }
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Pick the most urgent pending record that fits into the transmission and the air time budget of a transmitter
+ * reaching it: highest priority, then the oldest ticket. Returns serverNumPending if none fits, the time until the
+ * budget allows one in 'wait' [µs] and the transmitter in 'pin'.
+ **********************************************************************************************************************/
+static uint32_t ServerPick(const ServerWaveType *wave, uint64_t now, uint32_t *pin, uint64_t *wait)
+{
+  uint32_t pick = serverNumPending;
+
+  for(uint32_t i = 0; i < serverNumPending; i++) {
+    uint32_t select = RouteSelect(serverPending[i].pins & ServerIdle(wave, serverPending[i].airtime),
+      serverPending[i].airtime, wave->load, now, wait);
+    if(select == ROUTE_NONE) {
+      continue;
+    }
+    if((pick == serverNumPending) ||
+       (serverPending[i].record.priority > serverPending[pick].record.priority) ||
+       ((serverPending[i].record.priority == serverPending[pick].record.priority) &&
+        (serverPending[i].ticket < serverPending[pick].ticket))) {
+      pick = i;
+      *pin = select;
+    }
+  }
+
+  return pick;
+}
+
+/***********************************************************************************************************************
+ * Submit the due records that were scheduled for the same tick as one transmission, spread over the transmitters.
+ * Returns false if the budget allows none of them and the time until it does in 'wait' [µs].
+ **********************************************************************************************************************/
+static bool ServerDispatchDue(uint64_t now, uint64_t *wait)
+{
+  ServerWaveType wave = { .first = NULL, .last = &wave.first };
+  uint64_t tick = serverDue[0].record.start / SCHED_TICK;
+  uint32_t taken = 0;
+
+  while((taken < serverNumDue) && (wave.count < WAVE_MAX_CHAIN) &&
+        (serverDue[taken].record.start / SCHED_TICK == tick)) {
+    const ServerPendingType *due = &serverDue[taken];
+
+    // Rather an idle transmitter, but they all have to go now
+    uint32_t pin = RouteSelect(due->pins & ServerIdle(&wave, due->airtime), due->airtime, wave.load, now, wait);
+    if(pin == ROUTE_NONE) {
+      pin = RouteSelect(due->pins, due->airtime, wave.load, now, wait);
+    }
+    if(pin == ROUTE_NONE) {
+      // Out of budget, the rest waits for it
+      break;
+    }
+
+    uint32_t t = ServerPrepare(due);
+    if((t >= SERVER_TELEGRAMS) && (ServerTelegram() >= SERVER_TELEGRAMS)) {
+      // Out of telegrams, the rest goes with the next transmission
+      break;
+    }
+    taken++;
+    if(t < SERVER_TELEGRAMS) {
+      ServerAppend(&wave, t, pin, now);
+    }
+  }
+
+  serverNumDue -= taken;
+  memmove(&serverDue[0], &serverDue[taken], serverNumDue * sizeof(serverDue[0]));
+
+  ServerSubmit(&wave);
+
+  return taken != 0;
+}
+
+/***********************************************************************************************************************
+ * Submit the most urgent pending records as one transmission, at most one on each transmitter unless it fits into
+ * the time the others are busy. Returns false if the budget allows none of them and the time until it does in 'wait'.
+ **********************************************************************************************************************/
+static bool ServerDispatchPending(uint64_t now, uint64_t *wait)
+{
+  ServerWaveType wave = { .first = NULL, .last = &wave.first };
+  bool taken = false;
+  uint32_t pick, pin = ROUTE_NONE;
+
+  while((wave.count < WAVE_MAX_CHAIN) && (ServerTelegram() < SERVER_TELEGRAMS) &&
+        ((pick = ServerPick(&wave, now, &pin, wait)) < serverNumPending)) {
+    ServerPendingType pending = serverPending[pick];
+    serverPending[pick] = serverPending[--serverNumPending];
+    taken = true;
+
+    uint32_t t = ServerPrepare(&pending);
+    if(t < SERVER_TELEGRAMS) {
+      ServerAppend(&wave, t, pin, now);
+    }
+  }
+
+  ServerSubmit(&wave);
+
+  return taken;
+}
+
+/***********************************************************************************************************************
+ * Hand over records to the transmitters, due schedules first. Only one transmission is kept waiting behind the one on
+ * air, so that later records with higher priority can still overtake. Records exceeding the air time budget are held
+ * back, returns the time [µs] when the budget allows the next one (UINT64_MAX -> nothing held back).
+ **********************************************************************************************************************/
+static uint64_t ServerDispatch(void)
+{
+  while((serverNumDue || serverNumPending) && (RftxBacklog() == 0) && (ServerTelegram() < SERVER_TELEGRAMS)) {
+    uint64_t now = RtNow(), wait = UINT64_MAX;
+
+    // Due schedules wait for the budget, nothing overtakes them
+    if(serverNumDue) {
+      if(!ServerDispatchDue(now, &wait)) {
+        return now + wait;
+      }
+      continue;
+    }
+
+    if(!ServerDispatchPending(now, &wait)) {
+      return now + wait;
+    }
+  }
+
+  return UINT64_MAX;
+}
+
+/***********************************************************************************************************************
+ * Publish the statistics in the ring
+ **********************************************************************************************************************/
+static void ServerPublish(void)
+{
+  RingStatsType *stats = &serverRing->stats;
+  uint64_t now = RtNow();
+  RftxIdleStatsType idle;
+
+  for(uint32_t pin = 0; pin <= WAVE_MAX_PIN; pin++) {
+    __atomic_store_n(&stats->airtime[pin], AirtimeUsed(pin), __ATOMIC_RELAXED);
+    __atomic_store_n(&stats->budget[pin], AirtimeBudget(pin, now), __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&stats->pins, RouteTransmitters(), __ATOMIC_RELAXED);
+
+  RftxIdleStats(&idle);
+  __atomic_store_n(&stats->active, idle.active, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->idleTimeout, idle.idleTimeout / 1000000, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->startup, idle.startup, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->warmCount, idle.warmCount, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->coldCount, idle.coldCount, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->warmAverage, idle.warmCount ? idle.warmTotal / idle.warmCount : 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->coldAverage, idle.coldCount ? idle.coldTotal / idle.coldCount : 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->warmMax, idle.warmMax, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->coldMax, idle.coldMax, __ATOMIC_RELAXED);
+  __atomic_store_n(&stats->updated, now, __ATOMIC_RELEASE);
+}
+
+/***********************************************************************************************************************
+ * Put a record aside until its scheduled time. Due records held back by the air time budget count against the
+ * schedules, so that every schedule fits into the due list when its time comes.
+ **********************************************************************************************************************/
+static void ServerSchedule(const ServerPendingType *pending)
+{
+  if(serverNumDue >= serverNumFree) {
+    RingComplete(serverRing, pending->ticket, RingRejected);
+    return;
+  }
+
+  ServerScheduledType *scheduled = &serverScheduled[serverFree[--serverNumFree]];
+  scheduled->pending = *pending;
+  scheduled->used = true;
+  SchedAdd(&scheduled->timer, pending->record.start);
+}
+
+/***********************************************************************************************************************
+ * Move the records whose time has come to the due list
+ **********************************************************************************************************************/
+static void ServerExpire(void)
+{
+  SchedTimerType *timer, *next;
+
+  for(timer = SchedExpire(RtNow()); timer != NULL; timer = next) {
+    ServerScheduledType *scheduled = (ServerScheduledType *) timer;
+    next = timer->next;
+    if(serverNumDue < SCHED_MAX) {
+      serverDue[serverNumDue++] = scheduled->pending;
+    }
+    else {
+      ServerComplete(&scheduled->pending, RingRejected);
+    }
+    scheduled->used = false;
+    serverFree[serverNumFree++] = scheduled - serverScheduled;
+  }
+
+  ServerFuseAll(serverDue, &serverNumDue);
+}
+
+/***********************************************************************************************************************
+ * Check if a record carries out a ticket
+ **********************************************************************************************************************/
+static bool ServerOwns(const ServerPendingType *pending, uint64_t ticket)
+{
+  if(pending->ticket == ticket) {
+    return true;
+  }
+
+  for(uint32_t i = 0; i < pending->numJoined; i++) {
+    if(pending->joined[i] == ticket) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/***********************************************************************************************************************
+ * Cancel the record of a ticket in a list, returns false if it is not there
+ **********************************************************************************************************************/
+static bool ServerCancelList(ServerPendingType list[], uint32_t *count, uint64_t ticket)
+{
+  for(uint32_t i = 0; i < *count; i++) {
+    if(ServerOwns(&list[i], ticket)) {
+      ServerComplete(&list[i], RingCancelled);
+      (*count)--;
+      memmove(&list[i], &list[i + 1], (*count - i) * sizeof(list[0]));
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/***********************************************************************************************************************
+ * Cancel the record of a ticket wherever it is. A group telegram goes with all records joined to it, a telegram
+ * handed over to the transmitter cuts off its transmission, the others in flight are sent again. A record not yet
+ * taken from the ring is cancelled when it is taken.
+ **********************************************************************************************************************/
+static void ServerCancel(uint64_t ticket)
+{
+  // Still in the ring
+  if(ticket >= serverRing->tail) {
+    serverCancels[ticket % RING_SIZE] = ticket + 1;
+    return;
+  }
+
+  // Waiting for the transmitter
+  if(ServerCancelList(serverPending, &serverNumPending, ticket) || ServerCancelList(serverDue, &serverNumDue, ticket)) {
+    return;
+  }
+
+  // Waiting for its time
+  for(uint32_t i = 0; i < SCHED_MAX; i++) {
+    if(serverScheduled[i].used && ServerOwns(&serverScheduled[i].pending, ticket)) {
+      SchedCancel(&serverScheduled[i].timer);
+      ServerComplete(&serverScheduled[i].pending, RingCancelled);
+      serverScheduled[i].used = false;
+      serverFree[serverNumFree++] = i;
+      return;
+    }
+  }
+
+  // Queued or on air, completed through ServerDone()
+  for(uint32_t t = 0; t < SERVER_TELEGRAMS; t++) {
+    TelegramStateType state = RftxState(&serverTelegrams[t]);
+    if((state != TelegramQueued) && (state != TelegramOnAir)) {
+      continue;
+    }
+    for(uint32_t i = 0; i < serverNumTickets[t]; i++) {
+      if(serverTickets[t][i] == ticket) {
+        RftxCancel(&serverTelegrams[t]);
+        return;
+      }
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Serve the shared memory command ring forever, shutting the library down after 'idleTimeout' seconds without
+ * transmission (0 -> never)
+ **********************************************************************************************************************/
+void ServerRun(uint32_t idleTimeout)
+{
+  static uint64_t cancels[RING_SIZE];
+
+  if((serverRing = RingOpen(true)) == NULL) {
+    exit(EXIT_FAILURE);
+  }
+
+  RftxSetIdleTimeout(idleTimeout);
+  if(RftxOpen() < 0) {
+    exit(EXIT_FAILURE);
+  }
+
+  SchedInit(RtNow());
+  AirtimeInit(RtNow());
+  for(serverNumFree = 0; serverNumFree < SCHED_MAX; serverNumFree++) {
+    serverFree[serverNumFree] = serverNumFree;
+  }
+
+  for(;;) {
+    uint32_t events = RingEvents(serverRing);
+    bool received = false;
+    ServerPendingType pending;
+
+    // Collect new records, the ones for later go to the scheduler
+    while((serverNumPending < RING_SIZE) && RingReceive(serverRing, &pending.record, &pending.ticket)) {
+      pending.received = RtNow();
+      pending.airtime = ServerAirtime(&pending.record);
+      pending.pins = RouteReachable(&pending.record.command);
+      pending.numJoined = 0;
+      if(serverCancels[pending.ticket % RING_SIZE] == pending.ticket + 1) {
+        // Cancelled before it was taken
+        serverCancels[pending.ticket % RING_SIZE] = 0;
+        RingComplete(serverRing, pending.ticket, RingCancelled);
+      }
+      else if(pending.pins == 0) {
+        // No transmitter reaches the device
+        RingComplete(serverRing, pending.ticket, RingRejected);
+      }
+      else if(pending.record.start > pending.received + SCHED_TICK) {
+        ServerSchedule(&pending);
+      }
+      else {
+        pending.record.start = 0;
+        serverPending[serverNumPending++] = pending;
+        received = true;
+      }
+    }
+
+    // Cancel requests
+    for(uint32_t i = 0, n = RingCancelRequests(serverRing, cancels); i < n; i++) {
+      ServerCancel(cancels[i]);
+    }
+
+    // A scene may be submitted record by record
+    if(received) {
+      ServerFuseAll(serverPending, &serverNumPending);
+    }
+
+    ServerExpire();
+    uint64_t budget = ServerDispatch();
+    ServerPublish();
+
+    // Sleep until a record arrives, a transmission finishes, the next schedule is due or the budget allows more. The
+    // library has to be up by then.
+    uint64_t next = SchedNext(), now = RtNow();
+    next = (budget < next) ? budget : next;
+    RftxWarmUp((next == UINT64_MAX) ? 0 : next);
+    RingWait(serverRing, events, (next == UINT64_MAX) ? 0 : ((next > now) ? (next - now) : 1));
+  }
+}
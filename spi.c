@@ -0,0 +1,250 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "spi.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/spi/spidev.h>
+
+#include "rt.h"
+
+// Output device or its stand-in (-1 -> closed)
+static int spiFd = -1;
+static const char *spiDevice;
+// Regular file instead of a spidev device
+static bool spiFile;
+// Largest transfer spidev accepts [bytes]
+static uint32_t spiChunk;
+// Start of the last bitstream, CLOCK_MONOTONIC [µs]
+static uint64_t spiStarted;
+
+/***********************************************************************************************************************
+ * Largest transfer of spidev: its bufsiz module parameter
+ **********************************************************************************************************************/
+static uint32_t SpiChunkSize(void)
+{
+  uint32_t size = SPI_BUFSIZ_DEFAULT;
+  FILE *file;
+
+  if((file = fopen(SPI_BUFSIZ_PARAMETER, "r")) != NULL) {
+    if((fscanf(file, "%u", &size) != 1) || (size == 0)) {
+      size = SPI_BUFSIZ_DEFAULT;
+    }
+    fclose(file);
+  }
+
+  return size;
+}
+
+/***********************************************************************************************************************
+ * Open the spidev device and set up the bit clock. With STAND_IN_PREFIX in front, the bitstream is written into
+ * that file instead.
+ **********************************************************************************************************************/
+bool SpiOpen(const char *device)
+{
+  struct stat status;
+  uint8_t mode = SPI_MODE_0, bits = 8;
+  uint32_t speed = SPI_BIT_CLOCK;
+
+  // The stand-in gets the same transfers
+  spiChunk = SpiChunkSize();
+
+  spiFile = !strncmp(device, STAND_IN_PREFIX, strlen(STAND_IN_PREFIX));
+  if(spiFile) {
+    device += strlen(STAND_IN_PREFIX);
+    if((spiFd = open(device, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0) {
+      perror(device);
+      return false;
+    }
+    spiDevice = device;
+    return true;
+  }
+
+  if((spiFd = open(device, O_WRONLY | O_CLOEXEC)) < 0) {
+    perror(device);
+    return false;
+  }
+  spiDevice = device;
+
+  if(fstat(spiFd, &status)) {
+    perror(device);
+    SpiClose();
+    return false;
+  }
+  if(!S_ISCHR(status.st_mode)) {
+    fprintf(stderr, "%s: not a spidev device!\n", device);
+    SpiClose();
+    return false;
+  }
+
+  if(ioctl(spiFd, SPI_IOC_WR_MODE, &mode) || ioctl(spiFd, SPI_IOC_WR_BITS_PER_WORD, &bits) ||
+     ioctl(spiFd, SPI_IOC_WR_MAX_SPEED_HZ, &speed)) {
+    perror(device);
+    SpiClose();
+    return false;
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Render waveforms one after the other into a bitstream at SPI_BIT_CLOCK, most significant bit first. Each edge is
+ * put on the bit closest to its exact time, so the error does not add up. Returns the number of bytes (0 -> does
+ * not fit) and the timing error of the edges.
+ **********************************************************************************************************************/
+uint32_t SpiRender(const WaveType *waves[], uint32_t count, uint8_t *bits, uint32_t size, SpiErrorType *error)
+{
+  uint64_t time = 0, bit = 0, edges = 0;
+  double squares = 0;
+
+  error->max = 0;
+  for(uint32_t w = 0; w < count; w++) {
+    for(uint32_t r = 0; r < waves[w]->repetitions; r++) {
+      for(uint32_t p = 0; p < waves[w]->numPulses; p++) {
+        const WavePulseType *pulse = &waves[w]->pulses[p];
+
+        // Bit of the next edge
+        time += pulse->duration;
+        uint64_t edge = (time * SPI_BIT_CLOCK + 500000) / 1000000;
+        if(edge > (uint64_t) size * 8) {
+          return 0;
+        }
+
+        for(; bit < edge; bit++) {
+          if(pulse->level) {
+            bits[bit / 8] |= 0x80 >> (bit % 8);
+          }
+          else {
+            bits[bit / 8] &= ~(0x80 >> (bit % 8));
+          }
+        }
+
+        double deviation = fabs(edge * 1e6 / SPI_BIT_CLOCK - time);
+        error->max = (deviation > error->max) ? deviation : error->max;
+        squares += deviation * deviation;
+        edges++;
+      }
+    }
+  }
+
+  // Line back to low at the end
+  for(; bit % 8; bit++) {
+    bits[bit / 8] &= ~(0x80 >> (bit % 8));
+  }
+
+  error->rms = edges ? sqrt(squares / edges) : 0;
+
+  return bit / 8;
+}
+
+/***********************************************************************************************************************
+ * Length of the next transfer of a bitstream: at most 'size' bytes, cut after the last idle (all low) byte in it if
+ * there is one, so that the gap between the transfers only stretches a low phase
+ **********************************************************************************************************************/
+uint32_t SpiChunk(const uint8_t *bits, uint32_t length, uint32_t size)
+{
+  if(length <= size) {
+    return length;
+  }
+
+  for(uint32_t i = size; i > 0; i--) {
+    if(bits[i - 1] == 0) {
+      return i;
+    }
+  }
+
+  return size;
+}
+
+/***********************************************************************************************************************
+ * Render waveforms and send them out in as few transfers as spidev allows, returns when they have been sent out or
+ * false on failure
+ **********************************************************************************************************************/
+bool SpiSend(const WaveType *waves[], uint32_t count)
+{
+  static uint8_t bits[SPI_BUFFER_SIZE];
+  SpiErrorType error;
+  uint32_t length;
+
+  if((length = SpiRender(waves, count, bits, sizeof(bits), &error)) == 0) {
+    fprintf(stderr, "SpiSend(): transmission too long!\n");
+    return false;
+  }
+
+  fprintf(stderr, "spi: %u bytes at %u Hz, edge error max %.2f µs, rms %.2f µs\n", length, SPI_BIT_CLOCK,
+    error.max, error.rms);
+
+  spiStarted = RtNow();
+  for(uint32_t offset = 0, chunk; offset < length; offset += chunk) {
+    chunk = SpiChunk(&bits[offset], length - offset, spiChunk);
+    struct spi_ioc_transfer transfer = {
+      .tx_buf = (uintptr_t) &bits[offset],
+      .len = chunk,
+      .speed_hz = SPI_BIT_CLOCK,
+      .bits_per_word = 8
+    };
+    if(spiFile ? (write(spiFd, &bits[offset], chunk) != chunk) : (ioctl(spiFd, SPI_IOC_MESSAGE(1), &transfer) < 0)) {
+      perror(spiDevice);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Get the start of the last bitstream sent out, CLOCK_MONOTONIC [µs]
+ **********************************************************************************************************************/
+uint64_t SpiStarted(void)
+{
+  return spiStarted;
+}
+
+/***********************************************************************************************************************
+ * Close the device
+ **********************************************************************************************************************/
+void SpiClose(void)
+{
+  if(spiFd >= 0) {
+    close(spiFd);
+    spiFd = -1;
+  }
+}
@@ -0,0 +1,66 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#ifndef TELEGRAM_H_
+#define TELEGRAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "command.h"
+#include "wave.h"
+#include "librftx.h"
+
+// Encoded telegram, can be submitted again once it is done. The layout depends on the build configuration, it is only
+// known inside the library.
+struct RftxTelegram {
+  CommandType command;
+  WaveType wave;
+  volatile TelegramStateType state;
+  RftxCallbackType callback;
+  void *context;
+  // Submission and start of transmission [µs]
+  uint64_t submitted;
+  uint64_t started;
+  // Done, cancelled or failed, valid from the completion callback on
+  TelegramStateType result;
+  // Cancelled while handed over to the wave layer, cut off by the transmitter thread
+  bool cancel;
+  // Telegrams transmitted in the same wave: right after this one on the same pin, at the same time on other pins
+  RftxTelegramType *chained;
+  RftxTelegramType *next;
+};
+
+bool RftxPrepare(RftxTelegramType *telegram, const CommandType *command);
+
+#endif // TELEGRAM_H_
@@ -0,0 +1,155 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Check of the GPIO character device backend against its mock line: a telegram is driven into a file and the recorded
+ * edges are compared with the encoded pulses
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "command.h"
+#include "wave.h"
+#include "line.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/***********************************************************************************************************************
+ * Read the next recorded edge and compare it with the expected one, it must not have been driven before its deadline
+ **********************************************************************************************************************/
+static bool CheckEdge(FILE *file, const char *name, uint64_t at, uint32_t gpio, uint32_t expected, uint32_t *edges,
+  uint64_t *late)
+{
+  unsigned long long deadline, driven;
+  uint32_t pin, level;
+
+  if(fscanf(file, "%llu %llu %u %u", &deadline, &driven, &pin, &level) != 4) {
+    fprintf(stderr, "%s: edge %u missing\n", name, *edges);
+    return false;
+  }
+
+  if((deadline != at) || (pin != gpio) || (level != expected) || (driven < deadline)) {
+    fprintf(stderr, "%s: edge %u at %llu µs (driven %llu µs) gpio %u level %u, expected at %llu µs gpio %u level %u\n",
+      name, *edges, deadline, driven, pin, level, (unsigned long long) at, gpio, expected);
+    return false;
+  }
+
+  *late = (driven - deadline > *late) ? driven - deadline : *late;
+  (*edges)++;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Encode a command, drive it through the mock line and check the recorded edges against the encoded pulses:
+ * repetitions one after the other, back to low at the end
+ **********************************************************************************************************************/
+static bool CheckLine(int argc, char *argv[])
+{
+  static WaveType wave;
+  char fileName[] = "/tmp/rftx-line-XXXXXX", chip[sizeof(fileName) + sizeof(STAND_IN_PREFIX)];
+  const WaveType *waves[] = { &wave };
+  uint64_t time = 0, late = 0;
+  uint32_t edges = 0;
+  bool result = true, level = false;
+  CommandType command;
+  FILE *file;
+  int fd;
+
+  if((CommandParse(argc, argv, &command) != ParseOk) || !CommandEncode(&command, &wave)) {
+    fprintf(stderr, "%s: can not be encoded!\n", argv[1]);
+    return false;
+  }
+
+  if((fd = mkstemp(fileName)) < 0) {
+    perror(fileName);
+    return false;
+  }
+  close(fd);
+  snprintf(chip, sizeof(chip), "%s%s", STAND_IN_PREFIX, fileName);
+
+  if(!LineOpen(chip, 1U << wave.pin) || !LineSend(waves, 1)) {
+    LineClose();
+    unlink(fileName);
+    return false;
+  }
+  LineClose();
+
+  if((file = fopen(fileName, "r")) == NULL) {
+    perror(fileName);
+    unlink(fileName);
+    return false;
+  }
+
+  for(uint32_t r = 0; result && (r < wave.repetitions); r++) {
+    for(uint32_t p = 0; result && (p < wave.numPulses); p++) {
+      if(wave.pulses[p].level != level) {
+        level = wave.pulses[p].level;
+        result = CheckEdge(file, argv[1], time, wave.pin, level, &edges, &late);
+      }
+      time += wave.pulses[p].duration;
+    }
+  }
+  if(result && level) {
+    result = CheckEdge(file, argv[1], WaveAirtime(&wave), wave.pin, 0, &edges, &late);
+  }
+
+  if(result && (fscanf(file, "%*u") != EOF)) {
+    fprintf(stderr, "%s: more edges recorded than encoded\n", argv[1]);
+    result = false;
+  }
+
+  fclose(file);
+  unlink(fileName);
+
+  printf("%s: %u edges, driven up to %llu µs late, %s\n", argv[1], edges, (unsigned long long) late,
+    result ? "ok" : "FAILED");
+
+  return result;
+}
+
+/***********************************************************************************************************************
+ * Main
+ **********************************************************************************************************************/
+int main(void)
+{
+  bool result = true;
+
+  result = CheckLine(4, (char *[]) { "line", "gt9000", "1", "1", NULL }) && result;
+  result = CheckLine(5, (char *[]) { "line", "dmv7008", "5", "1", "0", NULL }) && result;
+  result = CheckLine(4, (char *[]) { "line", "borga", "2", "L", NULL }) && result;
+
+  return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,228 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+/***********************************************************************************************************************
+ * Check of the SPI bitstream backend: telegrams are rendered, split into transfers and written into a stand-in file,
+ * the bitstream is compared with the encoded pulses
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "command.h"
+#include "wave.h"
+#include "spi.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+// Transfer sizes besides spidev's default: a small one and one that ends in the middle of a telegram
+static const uint32_t checkChunkSizes[] = { SPI_BUFSIZ_DEFAULT, 512, 37 };
+
+/***********************************************************************************************************************
+ * Level of a bit of the bitstream
+ **********************************************************************************************************************/
+static bool CheckBit(const uint8_t *bits, uint64_t bit)
+{
+  return (bits[bit / 8] & (0x80 >> (bit % 8))) != 0;
+}
+
+/***********************************************************************************************************************
+ * Compare the bitstream with the encoded pulses: each pulse fills the bits up to the one nearest to its end, so no
+ * level change is more than half a bit off. The largest deviation of the level changes found must match the reported
+ * error.
+ **********************************************************************************************************************/
+static bool CheckBits(const char *name, const WaveType *wave, const uint8_t *bits, uint32_t length,
+  const SpiErrorType *error)
+{
+  uint64_t time = 0, bit = 0, end = (WaveAirtime(wave) * SPI_BIT_CLOCK + 500000) / 1000000;
+  double max = 0;
+
+  if(length != (end + 7) / 8) {
+    fprintf(stderr, "%s: %u bytes, expected %llu\n", name, length, (unsigned long long) (end + 7) / 8);
+    return false;
+  }
+
+  for(uint32_t r = 0; r < wave->repetitions; r++) {
+    for(uint32_t p = 0; p < wave->numPulses; p++) {
+      const WavePulseType *pulse = &wave->pulses[p];
+      uint64_t edge = ((time += pulse->duration) * SPI_BIT_CLOCK + 500000) / 1000000;
+
+      for(; bit < edge; bit++) {
+        if(CheckBit(bits, bit) != pulse->level) {
+          fprintf(stderr, "%s: bit %llu is %u, expected %u\n", name, (unsigned long long) bit, !pulse->level,
+            pulse->level);
+          return false;
+        }
+      }
+
+      // Level change in the stream
+      if((bit < end) && (CheckBit(bits, bit) != pulse->level)) {
+        double deviation = fabs(bit * 1e6 / SPI_BIT_CLOCK - time);
+        max = (deviation > max) ? deviation : max;
+      }
+    }
+  }
+
+  for(; bit < (uint64_t) length * 8; bit++) {
+    if(CheckBit(bits, bit)) {
+      fprintf(stderr, "%s: padding bit %llu is high\n", name, (unsigned long long) bit);
+      return false;
+    }
+  }
+
+  if((error->max > 0.5e6 / SPI_BIT_CLOCK) || (max > error->max) || (error->rms > error->max)) {
+    fprintf(stderr, "%s: edge error max %.2f µs rms %.2f µs reported, max %.2f µs found\n", name, error->max,
+      error->rms, max);
+    return false;
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Split the bitstream into transfers of at most 'size' bytes: they must cover it without gaps and be cut after the
+ * last idle byte that fits. Returns the number of transfers, 0 on failure.
+ **********************************************************************************************************************/
+static uint32_t CheckChunks(const char *name, const uint8_t *bits, uint32_t length, uint32_t size)
+{
+  uint32_t transfers = 0;
+
+  for(uint32_t offset = 0, chunk; offset < length; offset += chunk, transfers++) {
+    chunk = SpiChunk(&bits[offset], length - offset, size);
+    if((chunk == 0) || (chunk > size) || (chunk > length - offset)) {
+      fprintf(stderr, "%s: transfer %u of %u bytes at %u, at most %u\n", name, transfers, chunk, offset, size);
+      return 0;
+    }
+    // Not the last one: cut after the last idle byte that fits, if there is one
+    if(chunk < length - offset) {
+      uint32_t cut = size;
+      for(uint32_t i = size; i > 0; i--) {
+        if(bits[offset + i - 1] == 0) {
+          cut = i;
+          break;
+        }
+      }
+      if(chunk != cut) {
+        fprintf(stderr, "%s: transfer %u at %u cut after %u bytes, expected %u\n", name, transfers, offset, chunk,
+          cut);
+        return 0;
+      }
+    }
+  }
+
+  return transfers;
+}
+
+/***********************************************************************************************************************
+ * Encode a command, render it, check the bitstream and its transfers and that the stand-in file gets the same
+ **********************************************************************************************************************/
+static bool CheckSpi(int argc, char *argv[])
+{
+  static WaveType wave;
+  static uint8_t bits[SPI_BUFFER_SIZE], written[SPI_BUFFER_SIZE];
+  char fileName[] = "/tmp/rftx-spi-XXXXXX", device[sizeof(fileName) + sizeof(STAND_IN_PREFIX)];
+  const WaveType *waves[] = { &wave };
+  uint32_t length, transfers[sizeof(checkChunkSizes) / sizeof(checkChunkSizes[0])];
+  SpiErrorType error;
+  CommandType command;
+  bool result = true;
+  FILE *file;
+  int fd;
+
+  if((CommandParse(argc, argv, &command) != ParseOk) || !CommandEncode(&command, &wave)) {
+    fprintf(stderr, "%s: can not be encoded!\n", argv[1]);
+    return false;
+  }
+
+  if(((length = SpiRender(waves, 1, bits, sizeof(bits), &error)) == 0) ||
+     !CheckBits(argv[1], &wave, bits, length, &error)) {
+    fprintf(stderr, "%s: rendering FAILED\n", argv[1]);
+    return false;
+  }
+
+  for(uint32_t s = 0; s < sizeof(checkChunkSizes) / sizeof(checkChunkSizes[0]); s++) {
+    transfers[s] = CheckChunks(argv[1], bits, length, checkChunkSizes[s]);
+    if((transfers[s] == 0) || ((length > checkChunkSizes[s]) && (transfers[s] < 2))) {
+      fprintf(stderr, "%s: splitting into %u byte transfers FAILED\n", argv[1], checkChunkSizes[s]);
+      return false;
+    }
+  }
+
+  // Through the stand-in
+  if((fd = mkstemp(fileName)) < 0) {
+    perror(fileName);
+    return false;
+  }
+  close(fd);
+  snprintf(device, sizeof(device), "%s%s", STAND_IN_PREFIX, fileName);
+
+  if(!SpiOpen(device) || !SpiSend(waves, 1)) {
+    SpiClose();
+    unlink(fileName);
+    return false;
+  }
+  SpiClose();
+
+  if((file = fopen(fileName, "r")) == NULL) {
+    perror(fileName);
+    unlink(fileName);
+    return false;
+  }
+  if((fread(written, 1, sizeof(written), file) != length) || memcmp(written, bits, length)) {
+    fprintf(stderr, "%s: stand-in file differs from the bitstream\n", argv[1]);
+    result = false;
+  }
+  fclose(file);
+  unlink(fileName);
+
+  printf("%s: %u bytes, edge error max %.2f µs rms %.2f µs, %u/%u/%u transfers, %s\n", argv[1], length, error.max,
+    error.rms, transfers[0], transfers[1], transfers[2], result ? "ok" : "FAILED");
+
+  return result;
+}
+
+/***********************************************************************************************************************
+ * Main
+ **********************************************************************************************************************/
+int main(void)
+{
+  bool result = true;
+
+  result = CheckSpi(4, (char *[]) { "spi", "gt9000", "1", "1", NULL }) && result;
+  result = CheckSpi(5, (char *[]) { "spi", "dmv7008", "5", "1", "0", NULL }) && result;
+  result = CheckSpi(4, (char *[]) { "spi", "borga", "2", "L", NULL }) && result;
+
+  return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
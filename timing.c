@@ -0,0 +1,366 @@
+/***********************************************************************************************************************
+ *
+ * Wireless Signal Transmitter for Raspberry Pi
+ *
+ * By Gergely Budai
+ *
+ * This is free and unencumbered software released into the public domain.
+ *
+ * Anyone is free to copy, modify, publish, use, compile, sell, or
+ * distribute this software, either in source code form or as a compiled
+ * binary, for any purpose, commercial or non-commercial, and by any
+ * means.
+ *
+ * In jurisdictions that recognize copyright laws, the author or authors
+ * of this software dedicate any and all copyright interest in the
+ * software to the public domain. We make this dedication for the benefit
+ * of the public at large and to the detriment of our heirs and
+ * successors. We intend this dedication to be an overt act of
+ * relinquishment in perpetuity of all present and future rights to this
+ * software under copyright law.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * For more information, please refer to <http://unlicense.org/>
+ *
+ **********************************************************************************************************************/
+
+#include "config.h"
+#include "timing.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "gt9000.h"
+#include "dmv7008.h"
+#include "borga.h"
+#include "wave.h"
+
+// Timing of the devices matching a pattern
+typedef struct {
+  CommandDeviceType device;
+  TimingType timing;
+} TimingEntryType;
+
+// Parameters searched by the tuning mode
+typedef enum {
+  TunePause = 0,
+  TunePulses,
+  TuneRepeats,
+  TuneInvalid
+} TuneType;
+
+static TimingEntryType timingEntries[TIMING_MAX_ENTRIES];
+static uint32_t timingNumEntries = 0;
+
+/***********************************************************************************************************************
+ * Load a timing profile: one "module code channel short long pause repeats" line per device, code (hex) and channel
+ * as on the command line or '*' for any. Times in µs. With 'create' a missing file is an empty profile.
+ **********************************************************************************************************************/
+bool TimingLoad(const char *fileName, bool create)
+{
+  char line[BATCH_LINE_LENGTH], module[16], code[8], channel[8];
+  uint32_t lineNumber = 0;
+  FILE *file;
+
+  if((file = fopen(fileName, "r")) == NULL) {
+    // A profile to be created by the tuning mode
+    if(create && (errno == ENOENT)) {
+      return true;
+    }
+    perror(fileName);
+    return false;
+  }
+
+  while(fgets(line, sizeof(line), file) != NULL) {
+    TimingEntryType *entry = &timingEntries[timingNumEntries];
+    int fields = sscanf(line, "%15s %7s %7s %u %u %u %u", module, code, channel, &entry->timing.shortPulse,
+      &entry->timing.longPulse, &entry->timing.pause, &entry->timing.repeats);
+
+    lineNumber++;
+
+    // Skip empty lines and comments
+    if((fields <= 0) || (module[0] == '#')) {
+      continue;
+    }
+
+    if(timingNumEntries >= TIMING_MAX_ENTRIES) {
+      fprintf(stderr, "%s:%u: too many devices!\n", fileName, lineNumber);
+      fclose(file);
+      return false;
+    }
+
+    if((fields != 7) || !CommandParseDevice(module, code, channel, &entry->device) ||
+       !entry->timing.shortPulse || !entry->timing.longPulse || !entry->timing.repeats) {
+      fprintf(stderr, "%s:%u: invalid timing!\n", fileName, lineNumber);
+      fclose(file);
+      return false;
+    }
+    timingNumEntries++;
+  }
+
+  fclose(file);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Forget the loaded profile, every device gets the defaults of its module
+ **********************************************************************************************************************/
+void TimingUnload(void)
+{
+  timingNumEntries = 0;
+}
+
+/***********************************************************************************************************************
+ * Write the timing profile
+ **********************************************************************************************************************/
+bool TimingSave(const char *fileName)
+{
+  char device[32];
+  FILE *file;
+
+  if((file = fopen(fileName, "w")) == NULL) {
+    perror(fileName);
+    return false;
+  }
+
+  fprintf(file, "# module code channel short long pause repeats\n");
+  for(uint32_t i = 0; i < timingNumEntries; i++) {
+    CommandFormatDevice(device, sizeof(device), &timingEntries[i].device);
+    fprintf(file, "%s %u %u %u %u\n", device, timingEntries[i].timing.shortPulse, timingEntries[i].timing.longPulse,
+      timingEntries[i].timing.pause, timingEntries[i].timing.repeats);
+  }
+
+  if(fclose(file)) {
+    perror(fileName);
+    return false;
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Find the most specific profile entry for a command (NULL -> none)
+ **********************************************************************************************************************/
+static TimingEntryType *TimingFind(const CommandType *command)
+{
+  TimingEntryType *found = NULL;
+  int best = -1;
+
+  for(uint32_t i = 0; i < timingNumEntries; i++) {
+    int specific = (timingEntries[i].device.code >= 0) + (timingEntries[i].device.channel >= 0);
+    if(CommandMatchDevice(&timingEntries[i].device, command) && (specific > best)) {
+      found = &timingEntries[i];
+      best = specific;
+    }
+  }
+
+  return found;
+}
+
+/***********************************************************************************************************************
+ * Get the timing for a command: from the profile or the defaults of its module
+ **********************************************************************************************************************/
+const TimingType *TimingGet(const CommandType *command, const TimingType *defaults)
+{
+  TimingEntryType *entry = TimingFind(command);
+
+  return (entry != NULL) ? &entry->timing : defaults;
+}
+
+/***********************************************************************************************************************
+ * Check if the profile changes the timing of a command
+ **********************************************************************************************************************/
+bool TimingCustom(const CommandType *command)
+{
+  return TimingFind(command) != NULL;
+}
+
+/***********************************************************************************************************************
+ * Default timing of a module
+ **********************************************************************************************************************/
+static const TimingType *TimingDefaults(ModuleType module)
+{
+  switch(module) {
+    case ModuleGt9000:
+      return Gt9000Timing();
+
+    case ModuleDmv7008:
+      return Dmv7008Timing();
+
+    case ModuleBorga:
+      return BorgaTiming();
+
+    default:
+      return NULL;
+  }
+}
+
+/***********************************************************************************************************************
+ * Set one tuned parameter, pulses are scaled in percent keeping their ratio
+ **********************************************************************************************************************/
+static void TimingApply(TimingType *timing, const TimingType *base, TuneType tune, uint32_t value)
+{
+  *timing = *base;
+
+  switch(tune) {
+    case TunePause:
+      timing->pause = value;
+      break;
+
+    case TunePulses:
+      timing->shortPulse = base->shortPulse * value / 100;
+      timing->longPulse = base->longPulse * value / 100;
+      break;
+
+    default:
+      timing->repeats = value;
+      break;
+  }
+}
+
+/***********************************************************************************************************************
+ * Send a command with the timing under test and ask whether the device reacted (stdin: y/n, from the user or a
+ * loopback receiver). Absolute states are alternated, so that every try changes the device. Returns false if the
+ * tuning has to be aborted: the command could not be sent or there is no answer.
+ **********************************************************************************************************************/
+static bool TimingTry(CommandType *command, const TimingType *timing, const char *label, bool *reacted)
+{
+  static WaveType wave;
+  char answer[16];
+
+  if(CommandAbsolute(command)) {
+    command->command = !command->command;
+  }
+
+  if(!CommandEncode(command, &wave)) {
+    fprintf(stderr, "tune: %s can not be encoded!\n", label);
+    return false;
+  }
+  if(!WaveTransmit(&wave)) {
+    fprintf(stderr, "tune: %s could not be sent!\n", label);
+    return false;
+  }
+
+  for(;;) {
+    fprintf(stderr, "tune: %s (%u/%u µs, pause %u µs, %u repeats, %u µs air time), did the device react? [y/n] ",
+      label, timing->shortPulse, timing->longPulse, timing->pause, timing->repeats,
+      (uint32_t) WaveAirtime(&wave));
+    if(fgets(answer, sizeof(answer), stdin) == NULL) {
+      fprintf(stderr, "\ntune: no answer!\n");
+      return false;
+    }
+    if((answer[0] == 'y') || (answer[0] == 'n')) {
+      *reacted = answer[0] == 'y';
+      return true;
+    }
+  }
+}
+
+/***********************************************************************************************************************
+ * Search the shortest pause, pulses and number of repeats the device of a command still accepts, one after the other
+ * with a binary search, and store them with a safety margin in the profile file
+ **********************************************************************************************************************/
+bool TimingTune(const CommandType *command, const char *fileName)
+{
+  static const char *names[TuneInvalid] = { "pause [µs]", "pulses [%]", "repeats" };
+  CommandDeviceType device = { command->module, command->code, command->channel };
+  CommandType test = *command;
+  TimingType base, tuned;
+  TimingEntryType *entry;
+  char label[32];
+  bool reacted;
+
+  base = *TimingGet(command, TimingDefaults(command->module));
+
+  // The tuned timing goes into a profile entry for exactly this device
+  if(((entry = TimingFind(command)) == NULL) || (entry->device.code != device.code) ||
+     (entry->device.channel != device.channel)) {
+    if(timingNumEntries >= TIMING_MAX_ENTRIES) {
+      fprintf(stderr, "%s: too many devices!\n", fileName);
+      return false;
+    }
+    entry = &timingEntries[timingNumEntries++];
+    entry->device = device;
+  }
+  entry->timing = base;
+
+  if(!WaveStart()) {
+    return false;
+  }
+
+  // The starting point has to work
+  if(!TimingTry(&test, &base, "current timing", &reacted)) {
+    WaveStop();
+    return false;
+  }
+  if(!reacted) {
+    fprintf(stderr, "tune: the device does not react to the current timing!\n");
+    WaveStop();
+    return false;
+  }
+
+  for(TuneType tune = 0; tune < TuneInvalid; tune++) {
+    // Working (high) and failing (low) limits
+    uint32_t values[TuneInvalid][2] = {
+      [TunePause]   = { base.pause, base.longPulse },
+      [TunePulses]  = { 100, TIMING_MIN_PULSES },
+      [TuneRepeats] = { base.repeats, 1 }
+    };
+    uint32_t high = values[tune][0], low = values[tune][1];
+
+    if(low >= high) {
+      continue;
+    }
+
+    // The lowest value may work as well
+    TimingApply(&entry->timing, &base, tune, low);
+    snprintf(label, sizeof(label), "%s %u", names[tune], low);
+    if(!TimingTry(&test, &entry->timing, label, &reacted)) {
+      WaveStop();
+      return false;
+    }
+    if(reacted) {
+      high = low;
+    }
+
+    for(uint32_t step = 0; (step < TIMING_TUNE_STEPS) && (high - low > 1); step++) {
+      uint32_t middle = (low + high) / 2;
+      TimingApply(&entry->timing, &base, tune, middle);
+      snprintf(label, sizeof(label), "%s %u", names[tune], middle);
+      if(!TimingTry(&test, &entry->timing, label, &reacted)) {
+        WaveStop();
+        return false;
+      }
+      if(reacted) {
+        high = middle;
+      }
+      else {
+        low = middle;
+      }
+    }
+
+    // Keep a safety margin, the next parameter is searched with this one
+    high += (tune == TuneRepeats) ? (high * TIMING_MARGIN + 99) / 100 : high * TIMING_MARGIN / 100;
+    high = (high > values[tune][0]) ? values[tune][0] : high;
+    TimingApply(&tuned, &base, tune, high);
+    base = tuned;
+  }
+
+  WaveStop();
+
+  entry->timing = base;
+  fprintf(stderr, "tune: %u/%u µs, pause %u µs, %u repeats\n", base.shortPulse, base.longPulse, base.pause,
+    base.repeats);
+
+  return TimingSave(fileName);
+}
@@ -36,18 +36,365 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <pigpio.h>
 
-// Pulse length for debug visualisation (0 -> disable)
-static uint32_t waveDebugPulseLength = 0;
+#include "rt.h"
+#include "spi.h"
+#include "line.h"
 
-// Running wave time
-static uint32_t waveTime = 0;
+// VCD identifiers of the wire and the repetition counter of a pin
+#define WAVE_VCD_WIRE(pin)      ('!' + (pin))
+#define WAVE_VCD_COUNTER(pin)   ('A' + (pin))
+
+// One VCD value change: level of a pin or its repetition counter, in the order of creation at the same time
+typedef struct {
+  uint64_t time;
+  uint32_t order;
+  uint8_t pin;
+  bool counter;
+  uint32_t value;
+} WaveVcdChangeType;
+
+// VCD export file name (NULL -> disable), the file while it is open, its time origin (CLOCK_MONOTONIC [µs], 0 -> not
+// written yet) and the end of the last transmission in it [µs]
+static const char *waveVcdFileName = NULL;
+static FILE *waveVcd = NULL;
+static uint64_t waveVcdOrigin = 0;
+static uint64_t waveVcdEnd = 0;
+
+// SPI device of the bitstream backend (NULL -> pigpio waves)
+static const char *waveSpiDevice = NULL;
+
+// GPIO character device of the fast path for short telegrams (NULL -> disable)
+static const char *waveLineChip = NULL;
+
+// Output pins of the transmitters, one bit per GPIO
+static uint32_t wavePins = 1U << OUTPUT_PIN;
+
+// Waves handed over to the library in pipelined mode (-1 -> none)
+static int waveOnAir = -1;
+static int waveNext = -1;
+
+// Start of the transmission handed over last and expected end of all of them, CLOCK_MONOTONIC [µs]
+static uint64_t waveStarted = 0;
+static uint64_t waveEnd = 0;
+// Number of transmissions cut off by the watchdog
+static uint32_t waveResets = 0;
+
+// The library (or the SPI device) is up
+static bool waveActive = false;
+// The DMA engine is up, it is only started on demand next to the GPIO character device
+static bool waveDma = false;
+
+/***********************************************************************************************************************
+ * Set VCD export file (NULL -> disable)
+ **********************************************************************************************************************/
+void WaveSetVcdFile(const char *fileName)
+{
+  waveVcdFileName = fileName;
+}
+
+/***********************************************************************************************************************
+ * Send waveforms as a bitstream through a spidev device (or a regular file) instead of pigpio waves (NULL -> pigpio)
+ **********************************************************************************************************************/
+void WaveSetSpiDevice(const char *device)
+{
+  waveSpiDevice = device;
+}
+
+/***********************************************************************************************************************
+ * Set GPIO character device of the fast path for short telegrams (NULL -> disable)
+ **********************************************************************************************************************/
+void WaveSetLineChip(const char *chip)
+{
+  waveLineChip = chip;
+}
+
+/***********************************************************************************************************************
+ * Set the output pins of the transmitters, one bit per GPIO. New waves go to the lowest one.
+ **********************************************************************************************************************/
+void WaveSetPins(uint32_t pins)
+{
+  wavePins = pins;
+}
 
 /***********************************************************************************************************************
  * Initialize a new wave
  **********************************************************************************************************************/
-void WaveInitialize(uint32_t debugPulseLength)
+void WaveInitialize(WaveType *wave, uint32_t debugPulseLength)
+{
+  wave->debugPulseLength = debugPulseLength;
+  wave->pin = __builtin_ctz(wavePins);
+  wave->repetitions = 1;
+  wave->time = 0;
+  wave->numPulses = 0;
+  wave->overflow = false;
+}
+
+/***********************************************************************************************************************
+ * Add one pulse to the waveform
+ **********************************************************************************************************************/
+void WaveAddPulse(WaveType *wave, bool level, uint32_t duration)
+{
+  // Marked as invalid, it is not encoded
+  if(wave->numPulses >= WAVE_MAX_PULSES) {
+    fprintf(stderr, "WaveAddPulse(): too many pulses!\n");
+    wave->overflow = true;
+    return;
+  }
+
+  // Append pulse to the list
+  wave->pulses[wave->numPulses].level = level;
+  wave->pulses[wave->numPulses].duration = duration;
+  wave->numPulses++;
+
+  // Update end marker
+  wave->time += duration;
+}
+
+/***********************************************************************************************************************
+ * Time the transmitter is busy with the whole transmission, all repetitions [µs]
+ **********************************************************************************************************************/
+uint64_t WaveAirtime(const WaveType *wave)
+{
+  return (uint64_t) wave->time * wave->repetitions;
+}
+
+/***********************************************************************************************************************
+ * Render the debug visualisation of the telegram into a buffer and print it at once
+ **********************************************************************************************************************/
+static void WaveDebugPrint(const WaveType *wave)
+{
+  static char buffer[WAVE_DEBUG_BUFFER_SIZE];
+  static bool lastlevel = 0;
+  size_t length = 0;
+
+  for(uint32_t p = 0; p < wave->numPulses; p++) {
+    bool level = wave->pulses[p].level;
+    // One character corresponds to the half of the pulse length
+    for(int i = 0; i < (wave->pulses[p].duration / (wave->debugPulseLength / 2)); i++) {
+      // Leave room for an edge, a level and the closing line
+      if(length + 8 >= sizeof(buffer) - 64) {
+        break;
+      }
+      // Draw egdes
+      if(lastlevel != level) {
+        buffer[length++] = level ? '/' : '\\';
+        lastlevel = level;
+      }
+      // Draw signal levels
+      const char *mark = level ? "‾" : "_";
+      size_t markLength = strlen(mark);
+      memcpy(&buffer[length], mark, markLength);
+      length += markLength;
+    }
+  }
+
+  // Close debug message
+  length += snprintf(&buffer[length], sizeof(buffer) - length, " %u µS x %u = %u ms\n",
+    wave->time, wave->repetitions, wave->time * wave->repetitions / 1000);
+
+  fwrite(buffer, 1, length, stdout);
+  fflush(stdout);
+}
+
+/***********************************************************************************************************************
+ * Format a VCD value change: the level of a pin or its repetition counter
+ **********************************************************************************************************************/
+static void WaveVcdChange(FILE *vcd, const WaveVcdChangeType *change)
+{
+  char bits[33], *bit = &bits[32];
+  uint32_t value = change->value;
+
+  if(!change->counter) {
+    fprintf(vcd, "%u%c\n", value, WAVE_VCD_WIRE(change->pin));
+    return;
+  }
+
+  *bit = '\0';
+  do {
+    *--bit = (value & 1) ? '1' : '0';
+    value >>= 1;
+  } while(value);
+  fprintf(vcd, "b%s %c\n", bit, WAVE_VCD_COUNTER(change->pin));
+}
+
+/***********************************************************************************************************************
+ * Add a value change to the list
+ **********************************************************************************************************************/
+static void WaveVcdAdd(WaveVcdChangeType changes[], uint32_t *count, uint64_t time, uint8_t pin, bool counter,
+  uint32_t value)
+{
+  changes[*count] = (WaveVcdChangeType) { time, *count, pin, counter, value };
+  (*count)++;
+}
+
+/***********************************************************************************************************************
+ * Sort value changes by time, keeping the order of the changes at the same time
+ **********************************************************************************************************************/
+static int WaveVcdCompare(const void *a, const void *b)
+{
+  const WaveVcdChangeType *changeA = a, *changeB = b;
+
+  if(changeA->time != changeB->time) {
+    return (changeA->time > changeB->time) ? 1 : -1;
+  }
+
+  return (changeA->order > changeB->order) - (changeA->order < changeB->order);
+}
+
+/***********************************************************************************************************************
+ * Open the VCD file at the first transmission: one wire and one repetition counter per transmitter. After a restart
+ * of the library it is appended to. Returns false on failure.
+ **********************************************************************************************************************/
+static bool WaveVcdOpen(void)
+{
+  if((waveVcd = fopen(waveVcdFileName, waveVcdOrigin ? "a" : "w")) == NULL) {
+    return false;
+  }
+
+  if(waveVcdOrigin) {
+    return true;
+  }
+  waveVcdOrigin = RtNow();
+
+  time_t now = time(NULL);
+  fprintf(waveVcd, "$date %s $end\n", strtok(ctime(&now), "\n"));
+  fprintf(waveVcd, "$version RFTX $end\n");
+  fprintf(waveVcd, "$timescale 1us $end\n");
+  fprintf(waveVcd, "$scope module rftx $end\n");
+  for(uint32_t pin = 0; pin <= WAVE_MAX_PIN; pin++) {
+    if(wavePins & (1U << pin)) {
+      fprintf(waveVcd, "$var wire 1 %c gpio%u $end\n", WAVE_VCD_WIRE(pin), pin);
+      fprintf(waveVcd, "$var integer 32 %c repetition%u $end\n", WAVE_VCD_COUNTER(pin), pin);
+    }
+  }
+  fprintf(waveVcd, "$upscope $end\n");
+  fprintf(waveVcd, "$enddefinitions $end\n");
+  fprintf(waveVcd, "#0\n$dumpvars\n");
+  for(uint32_t pin = 0; pin <= WAVE_MAX_PIN; pin++) {
+    if(wavePins & (1U << pin)) {
+      fprintf(waveVcd, "0%c\nb0 %c\n", WAVE_VCD_WIRE(pin), WAVE_VCD_COUNTER(pin));
+    }
+  }
+  fprintf(waveVcd, "$end\n");
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Close the VCD file
+ **********************************************************************************************************************/
+static void WaveVcdClose(void)
+{
+  if((waveVcd != NULL) && fclose(waveVcd)) {
+    perror(waveVcdFileName);
+  }
+  waveVcd = NULL;
+}
+
+/***********************************************************************************************************************
+ * The VCD file can not be written: the export is given up, the transmissions go on
+ **********************************************************************************************************************/
+static void WaveVcdFail(void)
+{
+  perror(waveVcdFileName);
+  WaveVcdClose();
+  waveVcdFileName = NULL;
+}
+
+/***********************************************************************************************************************
+ * Append the pulse lists of one transmission with all repetitions to the Value Change Dump file. It starts when it is
+ * handed over, but not before the end of the transmission before.
+ **********************************************************************************************************************/
+static void WaveVcdExport(const WaveType *waves[], uint32_t count)
+{
+  uint64_t offsets[WAVE_MAX_CHAIN], start, length, lastTime = UINT64_MAX;
+  WaveVcdChangeType *changes;
+  uint32_t numChanges = 0, size = 0;
+
+  if((waveVcd == NULL) && !WaveVcdOpen()) {
+    WaveVcdFail();
+    return;
+  }
+
+  // Edges plus a counter change per repetition and the end of each telegram
+  for(uint32_t w = 0; w < count; w++) {
+    size += waves[w]->repetitions * (waves[w]->numPulses + 1) + 2;
+  }
+  if((changes = malloc(size * sizeof(changes[0]))) == NULL) {
+    WaveVcdFail();
+    return;
+  }
+
+  start = RtNow() - waveVcdOrigin;
+  start = (start > waveVcdEnd) ? start : waveVcdEnd;
+  length = WaveLayout(waves, count, offsets);
+
+  for(uint32_t w = 0; w < count; w++) {
+    const WaveType *wave = waves[w];
+    uint64_t time = start + offsets[w];
+    bool lastLevel = 0;
+
+    for(uint32_t r = 0; r < wave->repetitions; r++) {
+      WaveVcdAdd(changes, &numChanges, time, wave->pin, true, r + 1);
+      for(uint32_t p = 0; p < wave->numPulses; p++) {
+        if(wave->pulses[p].level != lastLevel) {
+          WaveVcdAdd(changes, &numChanges, time, wave->pin, false, wave->pulses[p].level);
+          lastLevel = wave->pulses[p].level;
+        }
+        time += wave->pulses[p].duration;
+      }
+    }
+
+    // End of the telegram: line back to low
+    WaveVcdAdd(changes, &numChanges, time, wave->pin, true, 0);
+    if(lastLevel) {
+      WaveVcdAdd(changes, &numChanges, time, wave->pin, false, 0);
+    }
+  }
+  qsort(changes, numChanges, sizeof(changes[0]), WaveVcdCompare);
+
+  // Time stamps are only written when they advance
+  for(uint32_t c = 0; c < numChanges; c++) {
+    if(changes[c].time != lastTime) {
+      fprintf(waveVcd, "#%llu\n", (unsigned long long) changes[c].time);
+      lastTime = changes[c].time;
+    }
+    WaveVcdChange(waveVcd, &changes[c]);
+  }
+  free(changes);
+
+  waveVcdEnd = start + length;
+  if(fflush(waveVcd)) {
+    WaveVcdFail();
+  }
+}
+
+/***********************************************************************************************************************
+ * Show and export the waveforms of one transmission if requested
+ **********************************************************************************************************************/
+static void WaveReport(const WaveType *waves[], uint32_t count)
+{
+  // Show debug
+  for(uint32_t w = 0; w < count; w++) {
+    if(waves[w]->debugPulseLength) {
+      WaveDebugPrint(waves[w]);
+    }
+  }
+
+  // Export waveform
+  if(waveVcdFileName != NULL) {
+    WaveVcdExport(waves, count);
+  }
+}
+
+/***********************************************************************************************************************
+ * Initialize the GPIO library and the output pins, returns false on failure
+ **********************************************************************************************************************/
+static bool WaveDmaStart(void)
 {
   // Disable interfaces
   gpioCfgInterfaces(PI_DISABLE_FIFO_IF | PI_DISABLE_SOCK_IF);
@@ -55,7 +402,7 @@ void WaveInitialize(uint32_t debugPulseLength)
   // Set sample rate
   if(gpioCfgClock(10, PI_CLOCK_PCM, 0)) {
     perror("gpioCfgClock()");
-    exit(EXIT_FAILURE);
+    return false;
   }
 
   // Initialise GPIO library with retries
@@ -68,129 +415,492 @@ void WaveInitialize(uint32_t debugPulseLength)
   }
   if(try >= INIT_TRIES) {
     perror("gpioInitialise()");
-    exit(EXIT_FAILURE);
+    return false;
   }
 
-  // Set Pullups and Pulldowns
-  if(gpioSetPullUpDown(OUTPUT_PIN, PI_PUD_OFF)) {
-    perror("gpioSetPullUpDown()");
-    exit(EXIT_FAILURE);
+  for(uint32_t pin = 0; pin <= WAVE_MAX_PIN; pin++) {
+    if(!(wavePins & (1U << pin))) {
+      continue;
+    }
+
+    // Set Pullups and Pulldowns
+    if(gpioSetPullUpDown(pin, PI_PUD_OFF)) {
+      perror("gpioSetPullUpDown()");
+      gpioTerminate();
+      return false;
+    }
+
+    // Set GPIO mode
+    if(gpioSetMode(pin, PI_OUTPUT)) {
+      perror("gpioSetMode()");
+      gpioTerminate();
+      return false;
+    }
+
+    // Set GPIO to Low
+    if(gpioWrite(pin, 0)) {
+      perror("gpioWrite()");
+      gpioTerminate();
+      return false;
+    }
   }
 
-  // Set GPIO mode
-  if(gpioSetMode(OUTPUT_PIN, PI_OUTPUT)) {
-    perror("gpioSetMode()");
-    exit(EXIT_FAILURE);
+  // Clear all waves
+  if(gpioWaveClear()) {
+    perror("gpioWaveClear()");
+    gpioTerminate();
+    return false;
   }
 
-  // Set GPIO to Low
-  if(gpioWrite(OUTPUT_PIN, 0)) {
-    perror("gpioWrite()");
-    exit(EXIT_FAILURE);
+  waveOnAir = -1;
+  waveNext = -1;
+  waveDma = true;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Initialize the backend, returns false on failure
+ **********************************************************************************************************************/
+bool WaveStart(void)
+{
+  // No DMA engine needed for SPI
+  if(waveSpiDevice != NULL) {
+    waveActive = SpiOpen(waveSpiDevice);
+  }
+  // DMA engine started when the first transmission does not suit the GPIO character device
+  else if(waveLineChip != NULL) {
+    waveActive = LineOpen(waveLineChip, wavePins);
+  }
+  else {
+    waveActive = WaveDmaStart();
+  }
+
+  return waveActive;
+}
+
+/***********************************************************************************************************************
+ * Send waveforms through the GPIO character device if its edge error is within their tolerance. Returns false if
+ * they have to go through the DMA engine (which is started if needed), otherwise whether they have been sent out in
+ * 'sent'.
+ **********************************************************************************************************************/
+static bool WaveLine(const WaveType *waves[], uint32_t count, bool *sent)
+{
+  if((waveLineChip != NULL) && LineSuits(waves, count)) {
+    // Not on top of a DMA transmission
+    WaveFlush();
+    *sent = LineSend(waves, count);
+    waveStarted = LineStarted();
+    return true;
+  }
+
+  if(!waveDma && !WaveDmaStart()) {
+    *sent = false;
+    return true;
+  }
+
+  return false;
+}
+
+/***********************************************************************************************************************
+ * Stop the transmission and everything queued behind it, clear all waves and set the outputs low
+ **********************************************************************************************************************/
+static void WaveReset(void)
+{
+  // Carry on with what is left, the transmission is over anyway
+  if(gpioWaveTxStop()) {
+    perror("gpioWaveTxStop()");
   }
 
-  // Clear all waves
   if(gpioWaveClear()) {
     perror("gpioWaveClear()");
-    exit(EXIT_FAILURE);
   }
 
-  // Reset wave time
-  waveTime = 0;
+  for(uint32_t pin = 0; pin <= WAVE_MAX_PIN; pin++) {
+    if((wavePins & (1U << pin)) && gpioWrite(pin, 0)) {
+      perror("gpioWrite()");
+    }
+  }
 
-  // Set debug pulse length
-  waveDebugPulseLength = debugPulseLength;
+  waveOnAir = -1;
+  waveNext = -1;
+  waveEnd = RtNow();
 }
 
 /***********************************************************************************************************************
- * Add one pulse to the waveform
+ * Watchdog: reset the library if the transmission is overdue, returns true if it has been reset
  **********************************************************************************************************************/
-void WaveAddPulse(bool level, uint32_t duration)
+static bool WaveOverdue(void)
 {
-  gpioPulse_t wave[2];
+  uint64_t now = RtNow();
+
+  if(now <= waveEnd + (uint64_t) (WAVE_WATCHDOG_MARGIN * 1000000)) {
+    return false;
+  }
+
+  fprintf(stderr, "wave: transmission overdue by %llu µs, reset\n", (unsigned long long) (now - waveEnd));
+  WaveReset();
+  waveResets++;
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Add one telegram to the wave being built, starting at 'offset' [µs]. Returns false on failure, the wave being built
+ * is discarded.
+ **********************************************************************************************************************/
+static bool WaveAddTelegram(const WaveType *wave, uint32_t offset)
+{
+  static gpioPulse_t pulses[WAVE_MAX_PULSES + 1];
+  uint32_t numPulses = 0;
 
   // We need to start with a delay to be able to append to the wave
-  wave[0].gpioOn = 0;
-  wave[0].gpioOff = 0;
-  wave[0].usDelay = waveTime;
+  if(offset) {
+    pulses[numPulses].gpioOn = 0;
+    pulses[numPulses].gpioOff = 0;
+    pulses[numPulses].usDelay = offset;
+    numPulses++;
+  }
 
-  // Define pulse
-  if(level) {
-    // High
-    wave[1].gpioOn  = 1 << OUTPUT_PIN;
-    wave[1].gpioOff = 0;
+  // Convert pulse list
+  for(uint32_t p = 0; p < wave->numPulses; p++, numPulses++) {
+    if(wave->pulses[p].level) {
+      // High
+      pulses[numPulses].gpioOn  = 1U << wave->pin;
+      pulses[numPulses].gpioOff = 0;
+    }
+    else {
+      // Low
+      pulses[numPulses].gpioOn  = 0;
+      pulses[numPulses].gpioOff = 1U << wave->pin;
+    }
+    pulses[numPulses].usDelay = wave->pulses[p].duration;
   }
-  else {
-    // Low
-    wave[1].gpioOn  = 0;
-    wave[1].gpioOff = 1 << OUTPUT_PIN;
+
+  // Add pulses to wave
+  if(gpioWaveAddGeneric(numPulses, pulses) < 0) {
+    perror("gpioWaveAddGeneric()");
+    gpioWaveAddNew();
+    return false;
   }
-  wave[1].usDelay = duration;
 
-  // Update end marker
-  waveTime += duration;
+  return true;
+}
 
-  // Add pulse to wave
-  if(gpioWaveAddGeneric(2, wave) < 0) {
-    perror("gpioWaveAddGeneric()");
-    exit(EXIT_FAILURE);
+/***********************************************************************************************************************
+ * Create a waveform in the library from the pulses added, returns its id (< 0 -> failure)
+ **********************************************************************************************************************/
+static int WaveCreate(void)
+{
+  int wave_id;
+
+  if((wave_id = gpioWaveCreate()) < 0) {
+    perror("gpioWaveCreate()");
+    gpioWaveAddNew();
   }
 
-  // Show debug
-  if(waveDebugPulseLength) {
-    static bool lastlevel = 0;
-    // One character corresponds to the half of the pulse length
-    for(int i = 0; i < (duration / (waveDebugPulseLength / 2)); i++) {
-      // Draw egdes
-      if(lastlevel != level) {
-        printf(level ? "/" : "\\");
-        lastlevel = level;
-      }
-      // Draw signal levels
-      printf(level ? "‾" : "_");
-    }
+  return wave_id;
+}
+
+/***********************************************************************************************************************
+ * Delete a waveform from the library
+ **********************************************************************************************************************/
+static void WaveDelete(int wave_id)
+{
+  // The library is in trouble, the watchdog clears it
+  if(gpioWaveDelete(wave_id) < 0) {
+    perror("gpioWaveDelete()");
   }
 }
 
 /***********************************************************************************************************************
- * Transmit waveform
+ * Transmit waveform and wait until it has been sent out, returns false on failure or if the watchdog had to cut it off
  **********************************************************************************************************************/
-void WaveTransmit(uint32_t repetitions)
+bool WaveTransmit(const WaveType *wave)
 {
+  bool sent;
   int wave_id;
 
-  // Close debug message
-  if(waveDebugPulseLength) {
-    printf(" %u µS x %u = %u ms\n", waveTime, repetitions, waveTime * repetitions / 1000);
+  WaveReport(&wave, 1);
+
+  if(waveSpiDevice != NULL) {
+    sent = SpiSend(&wave, 1);
+    waveStarted = SpiStarted();
+    return sent;
+  }
+
+  if(WaveLine(&wave, 1, &sent)) {
+    return sent;
   }
 
   // Create waveform
-  if((wave_id = gpioWaveCreate()) < 0) {
-    perror("gpioWaveCreate()");
-    exit(EXIT_FAILURE);
+  if(!WaveAddTelegram(wave, 0) || ((wave_id = WaveCreate()) < 0)) {
+    return false;
   }
 
   // Transmit the waveform 'repetitions' times
   if(gpioWaveChain((char []) {
     255, 0,
       wave_id,
-    255, 1, repetitions, 0
+    255, 1, wave->repetitions & 0xFF, wave->repetitions >> 8
   }, 7) < 0) {
     perror("gpioWaveChain()");
-    exit(EXIT_FAILURE);
+    WaveDelete(wave_id);
+    return false;
   }
+  waveStarted = RtNow();
+  waveEnd = waveStarted + WaveAirtime(wave);
 
-  // Wait until the transmission has been sent out
+  // Wait until the transmission has been sent out, the watchdog deletes the wave
   while(gpioWaveTxBusy()) {
-    time_sleep(WAVE_TX_POLL_DELAY);
+    if(WaveOverdue()) {
+      return false;
+    }
+    RtSleep(WAVE_TX_POLL_DELAY);
   }
 
   //  Delete the wave
-  if(gpioWaveDelete(wave_id) < 0) {
-    perror("gpioWaveDelete()");
-    exit(EXIT_FAILURE);
+  WaveDelete(wave_id);
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Release finished pipelined waveforms and return the number of waveforms still waiting or on air
+ **********************************************************************************************************************/
+uint32_t WavePending(void)
+{
+  // SPI and GPIO character device transfers are synchronous
+  if((waveSpiDevice != NULL) || !waveDma) {
+    return 0;
+  }
+
+  // The next wave has started (or everything is done): the one before is finished
+  if((waveNext >= 0) && (gpioWaveTxAt() != waveOnAir)) {
+    WaveDelete(waveOnAir);
+    waveOnAir = waveNext;
+    waveNext = -1;
+  }
+
+  // Stuck
+  if((waveOnAir >= 0) && WaveOverdue()) {
+    return 0;
+  }
+
+  // Delete finished wave
+  if((waveOnAir >= 0) && (waveNext < 0) && !gpioWaveTxBusy()) {
+    WaveDelete(waveOnAir);
+    waveOnAir = -1;
+  }
+
+  return (waveOnAir >= 0) + (waveNext >= 0);
+}
+
+/***********************************************************************************************************************
+ * Lay out waveforms in one transmission: each one starts at the end of the one before on the same pin, different pins
+ * transmit at the same time (on MOSI all of them one after the other). Returns the start of each one in 'offsets'
+ * [µs] and the length of the transmission [µs].
+ **********************************************************************************************************************/
+uint64_t WaveLayout(const WaveType *waves[], uint32_t count, uint64_t offsets[])
+{
+  uint64_t end[WAVE_MAX_PIN + 1] = { 0 }, length = 0;
+
+  for(uint32_t w = 0; w < count; w++) {
+    uint32_t pin = (waveSpiDevice != NULL) ? 0 : waves[w]->pin;
+
+    offsets[w] = end[pin];
+    end[pin] += WaveAirtime(waves[w]);
+    length = (end[pin] > length) ? end[pin] : length;
+  }
+
+  return length;
+}
+
+/***********************************************************************************************************************
+ * Queue waveforms as one chained transmission behind the one on air and return as soon as the library has accepted
+ * it. The wave is created while the previous one is still being transmitted and starts right at its end. Returns
+ * false if it could not be handed over.
+ **********************************************************************************************************************/
+bool WaveQueueChain(const WaveType *waves[], uint32_t count)
+{
+  uint64_t offsets[WAVE_MAX_CHAIN], length, now;
+  bool sent;
+  int wave_id;
+
+  WaveReport(waves, count);
+
+  // One after the other on MOSI
+  if(waveSpiDevice != NULL) {
+    sent = SpiSend(waves, count);
+    waveStarted = SpiStarted();
+    return sent;
+  }
+
+  if(WaveLine(waves, count, &sent)) {
+    return sent;
+  }
+
+  // Create waveform with all telegrams and repetitions, a synchronised wave can not be chained. Telegrams on
+  // different pins are merged by the library.
+  length = WaveLayout(waves, count, offsets);
+  for(uint32_t w = 0; w < count; w++) {
+    for(uint32_t r = 0; r < waves[w]->repetitions; r++) {
+      if(!WaveAddTelegram(waves[w], offsets[w] + (uint64_t) r * waves[w]->time)) {
+        return false;
+      }
+    }
+  }
+  if((wave_id = WaveCreate()) < 0) {
+    return false;
+  }
+
+  // Only one wave can wait behind the one on air: wait until it has started
+  while(WavePending() > 1) {
+    RtSleep(WAVE_SYNC_POLL_DELAY);
+  }
+
+  // Start the wave right at the end of the current one
+  if(gpioWaveTxSend(wave_id, PI_WAVE_MODE_ONE_SHOT_SYNC) < 0) {
+    perror("gpioWaveTxSend()");
+    WaveDelete(wave_id);
+    return false;
+  }
+  now = RtNow();
+  waveStarted = ((waveOnAir >= 0) && (waveEnd > now)) ? waveEnd : now;
+  waveEnd = waveStarted + length;
+  if(waveOnAir >= 0) {
+    waveNext = wave_id;
+  }
+  else {
+    waveOnAir = wave_id;
+  }
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Queue one waveform behind the one on air
+ **********************************************************************************************************************/
+bool WaveQueue(const WaveType *wave)
+{
+  return WaveQueueChain(&wave, 1);
+}
+
+/***********************************************************************************************************************
+ * Wait until all queued waveforms have been sent out
+ **********************************************************************************************************************/
+void WaveFlush(void)
+{
+  if((waveSpiDevice != NULL) || !waveDma) {
+    return;
+  }
+
+  while(gpioWaveTxBusy() && !WaveOverdue()) {
+    RtSleep(WAVE_TX_POLL_DELAY);
+  }
+
+  if(waveOnAir >= 0) {
+    WaveDelete(waveOnAir);
+    waveOnAir = -1;
+  }
+  if(waveNext >= 0) {
+    WaveDelete(waveNext);
+    waveNext = -1;
+  }
+}
+
+/***********************************************************************************************************************
+ * Cut off the transmission on air, the library can only stop it together with the one queued behind it
+ **********************************************************************************************************************/
+void WaveCancel(void)
+{
+  // SPI and GPIO character device transfers are synchronous
+  if((waveSpiDevice != NULL) || !waveActive || !waveDma) {
+    return;
+  }
+
+  WaveReset();
+}
+
+/***********************************************************************************************************************
+ * Get the start of the transmission handed over last, CLOCK_MONOTONIC [µs]: when its first pulse went out, or is
+ * going to go out behind the one on air
+ **********************************************************************************************************************/
+uint64_t WaveStarted(void)
+{
+  return waveStarted;
+}
+
+/***********************************************************************************************************************
+ * Get the number of transmissions cut off by the watchdog so far
+ **********************************************************************************************************************/
+uint32_t WaveResets(void)
+{
+  return waveResets;
+}
+
+/***********************************************************************************************************************
+ * Terminate the library and clean up
+ **********************************************************************************************************************/
+void WaveStop(void)
+{
+  waveActive = false;
+  WaveVcdClose();
+
+  if(waveSpiDevice != NULL) {
+    SpiClose();
+    return;
+  }
+
+  if(waveLineChip != NULL) {
+    LineClose();
+  }
+
+  if(waveDma) {
+    gpioTerminate();
+    waveDma = false;
+  }
+}
+
+/***********************************************************************************************************************
+ * Check if the library is up
+ **********************************************************************************************************************/
+bool WaveActive(void)
+{
+  return waveActive;
+}
+
+/***********************************************************************************************************************
+ * Shut the library down while there is nothing to send, so that it stops sampling. Returns false if it is not up or
+ * there is nothing to gain (SPI).
+ **********************************************************************************************************************/
+bool WaveSuspend(void)
+{
+  if(!waveActive || (waveSpiDevice != NULL)) {
+    return false;
+  }
+
+  WaveFlush();
+  WaveStop();
+
+  return true;
+}
+
+/***********************************************************************************************************************
+ * Bring the library up again after WaveSuspend(), returns the time it took [µs] (0 -> it was up or failed to come up)
+ **********************************************************************************************************************/
+uint64_t WaveResume(void)
+{
+  uint64_t start = RtNow();
+
+  if(waveActive) {
+    return 0;
+  }
+
+  // Still down on failure
+  if(!WaveStart()) {
+    return 0;
   }
 
-  // Terminate the library and clean up
-  gpioTerminate();
+  return RtNow() - start + 1;
 }
@@ -34,11 +34,55 @@
 #ifndef WAVE_H_
 #define WAVE_H_
 
+#include "config.h"
+
 #include <stdint.h>
 #include <stdbool.h>
 
-void WaveInitialize(uint32_t debugPulseLength);
-void WaveAddPulse(bool level, uint32_t duration);
-void WaveTransmit(uint32_t repetitions);
+// One pulse of a telegram
+typedef struct {
+  bool level;
+  uint32_t duration;
+} WavePulseType;
+
+// Telegram waveform
+typedef struct {
+  // Pulse length for debug visualisation (0 -> disable)
+  uint32_t debugPulseLength;
+  // Output pin of the transmitter
+  uint32_t pin;
+  // Number of times the telegram is sent
+  uint32_t repetitions;
+  // Length of one telegram [µs]
+  uint32_t time;
+  // Pulses of one telegram
+  uint32_t numPulses;
+  WavePulseType pulses[WAVE_MAX_PULSES];
+  // More pulses were added than fit, the waveform is invalid
+  bool overflow;
+} WaveType;
+
+void WaveSetVcdFile(const char *fileName);
+void WaveSetSpiDevice(const char *device);
+void WaveSetLineChip(const char *chip);
+void WaveSetPins(uint32_t pins);
+void WaveInitialize(WaveType *wave, uint32_t debugPulseLength);
+void WaveAddPulse(WaveType *wave, bool level, uint32_t duration);
+uint64_t WaveAirtime(const WaveType *wave);
+
+bool WaveStart(void);
+bool WaveTransmit(const WaveType *wave);
+uint64_t WaveLayout(const WaveType *waves[], uint32_t count, uint64_t offsets[]);
+bool WaveQueue(const WaveType *wave);
+bool WaveQueueChain(const WaveType *waves[], uint32_t count);
+uint32_t WavePending(void);
+void WaveFlush(void);
+void WaveCancel(void);
+uint64_t WaveStarted(void);
+uint32_t WaveResets(void);
+void WaveStop(void);
+bool WaveActive(void);
+bool WaveSuspend(void);
+uint64_t WaveResume(void);
 
 #endif // WAVE_H_